@@ -0,0 +1,105 @@
+#include "BufferRing.h"
+
+#include <algorithm>
+#include <cstring>
+
+void BufferRing::create(GLenum target_, GLuint binding_, GLsizeiptr size) {
+    target = target_;
+    binding = binding_;
+    allocate(size);
+}
+
+void BufferRing::destroy() {
+    release();
+    hasData = false;
+    last.clear();
+}
+
+void BufferRing::allocate(GLsizeiptr size) {
+    blockSize = size;
+    slot = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+
+    if (!(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)) {
+        glBufferData(target, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(target, binding, buffer);
+        return;
+    }
+
+    GLint alignment = 256;
+    glGetIntegerv(target == GL_SHADER_STORAGE_BUFFER ? GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+                                                     : GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    stride = (size + alignment - 1) / alignment * alignment;
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(target, stride * slots, nullptr, flags);
+    mapped = static_cast<std::uint8_t*>(glMapBufferRange(target, 0, stride * slots, flags));
+    std::memset(mapped, 0, (size_t)(stride * slots));
+    glBindBufferRange(target, binding, buffer, 0, blockSize);
+}
+
+// GL defers deleting the buffer until the commands still reading it are done
+void BufferRing::release() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (mapped) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        mapped = nullptr;
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
+
+bool BufferRing::write(std::initializer_list<Part> parts) {
+    GLsizeiptr size = 0;
+    bool same = hasData;
+    for (const Part& part : parts) {
+        same = same && size + part.size <= (GLsizeiptr)last.size()
+               && (part.size == 0 || std::memcmp(last.data() + size, part.data, (size_t)part.size) == 0);
+        size += part.size;
+    }
+    if (same && (GLsizeiptr)last.size() == size) return false;
+
+    last.resize((size_t)size);
+    GLsizeiptr offset = 0;
+    for (const Part& part : parts) {
+        if (part.size) std::memcpy(last.data() + offset, part.data, (size_t)part.size);
+        offset += part.size;
+    }
+
+    if (size > blockSize) {
+        release();
+        allocate(std::max(size, blockSize + blockSize / 2));
+        hasData = false; // the fresh slots hold nothing the GPU reads
+    }
+
+    if (!mapped) {
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, 0, size, last.data());
+        hasData = true;
+        return true;
+    }
+
+    if (hasData) {
+        // everything issued so far that reads this slot is behind the fence
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot = (slot + 1) % slots;
+    }
+    if (GLsync& fence = fences[slot]) {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    offset = slot * stride;
+    for (const Part& part : parts) {
+        if (part.size) std::memcpy(mapped + offset, part.data, (size_t)part.size);
+        offset += part.size;
+    }
+    glBindBufferRange(target, binding, buffer, slot * stride, blockSize);
+    hasData = true;
+    return true;
+}
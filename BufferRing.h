@@ -0,0 +1,51 @@
+#ifndef BLACKHOLESFML_BUFFERRING_H
+#define BLACKHOLESFML_BUFFERRING_H
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+// One uniform or shader storage block backed by a persistently mapped buffer with
+// `slots` copies. A write that changes the data goes to the next slot, once the
+// fence left there a round ago has passed, and rebinds the block to it; the GPU may
+// still be reading the previous slot, so the CPU never waits on it. Unchanged data
+// is not written at all: the ring keeps a copy of the last write to compare with,
+// the mapping itself is write-only. A write larger than the slots reallocates them
+// with some headroom. Without GL 4.4 / ARB_buffer_storage it is a plain buffer
+// updated with glBufferSubData, still with the change check.
+class BufferRing {
+public:
+    // target is GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER; needs the GL context
+    void create(GLenum target, GLuint binding, GLsizeiptr size);
+    void destroy(); // needs it as well
+
+    struct Part {
+        const void* data;
+        GLsizeiptr size;
+    };
+
+    // false when the data matched the last write
+    bool write(const void* data, GLsizeiptr size) { return write({{data, size}}); }
+    // the parts back to back, each copied straight into the slot
+    bool write(std::initializer_list<Part> parts);
+
+private:
+    static constexpr int slots = 3;
+
+    GLenum target = GL_UNIFORM_BUFFER;
+    GLuint buffer = 0;
+    GLuint binding = 0;
+    GLsizeiptr blockSize = 0; // capacity of one slot
+    GLsizeiptr stride = 0;
+    std::uint8_t* mapped = nullptr;
+    GLsync fences[slots]{};
+    int slot = 0;
+    bool hasData = false;
+    std::vector<std::uint8_t> last;
+
+    void allocate(GLsizeiptr size);
+    void release();
+};
+
+#endif //BLACKHOLESFML_BUFFERRING_H
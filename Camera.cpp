@@ -24,6 +24,7 @@ void Camera::processMouseMove(float x, float y) {
         azimuth   += dx * orbitSpeed;
         elevation -= dy * orbitSpeed;
         elevation = glm::clamp(elevation, 0.01f, float(M_PI) - 0.01f);
+        changed = true;
     }
     lastX = x; lastY = y;
 }
@@ -38,6 +39,7 @@ void Camera::processMouseButton(sf::Mouse::Button button, bool pressed, const sf
         } else {
             dragging = false;
         }
+        changed = true;
     }
 }
 
@@ -45,6 +47,7 @@ void Camera::processScroll(float /*xoffset*/, float yoffset) {
     radius -= yoffset * zoomSpeed;
     radius = glm::clamp(radius, minRadius, maxRadius);
     scrolling = true;
+    changed = true;
 }
 
 void Camera::processKey(sf::Keyboard::Scancode key, bool pressed) { }
@@ -12,8 +12,11 @@ public:
     bool resizing = false;
     bool scrolling = false;
     bool moving = false;
+    bool changed = false; // view or motion state changed, the caller clears it once redrawn
 
     Camera() = default;
+    // at a fixed orbit position, elevation measured from +y
+    Camera(float radius_, float elevation_, float azimuth_) : radius(radius_), azimuth(azimuth_), elevation(elevation_) {}
 
     [[nodiscard]] glm::vec3 position() const;
 
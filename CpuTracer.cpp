@@ -0,0 +1,232 @@
+#include "CpuTracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+
+#include "Integrator.h"
+
+// Everything below mirrors geodesicComp step for step, float precision included,
+// so that CPU and GPU frames can be compared pixel for pixel.
+namespace {
+    struct Ray {
+        float x, y, z, r, theta, phi;
+        float dr, dtheta, dphi;
+        float E, L;
+    };
+
+    Ray initRay(glm::vec3 pos, glm::vec3 dir, float rs) {
+        Ray ray{};
+        ray.x = pos.x; ray.y = pos.y; ray.z = pos.z;
+        ray.r = glm::length(pos);
+        ray.theta = std::acos(pos.z / ray.r);
+        ray.phi = std::atan2(pos.y, pos.x);
+
+        const float dx = dir.x, dy = dir.y, dz = dir.z;
+        const float st = std::sin(ray.theta), ct = std::cos(ray.theta);
+        const float sp = std::sin(ray.phi), cp = std::cos(ray.phi);
+        ray.dr     = st*cp*dx + st*sp*dy + ct*dz;
+        ray.dtheta = (ct*cp*dx + ct*sp*dy - st*dz) / ray.r;
+        ray.dphi   = (-sp*dx + cp*dy) / (ray.r * st);
+
+        ray.L = ray.r * ray.r * st * ray.dphi;
+        const float f = 1.0f - rs / ray.r;
+        const float dt_dL = std::sqrt((ray.dr*ray.dr)/f + ray.r*ray.r*(ray.dtheta*ray.dtheta + st*st*ray.dphi*ray.dphi));
+        ray.E = f * dt_dL;
+
+        return ray;
+    }
+
+    bool intercept(const Ray& ray, float rs) {
+        return ray.r <= rs;
+    }
+
+    // Returns the index of the first object containing the ray, or -1
+    int interceptObject(const Ray& ray, const std::vector<ObjectData>& objs, const ObjectShells& shells) {
+        const glm::vec3 P(ray.x, ray.y, ray.z);
+        const int s = shells.shellOf(ray.r);
+        for (int k = shells.first[s]; k < shells.first[s] + shells.count[s]; ++k) {
+            const int i = shells.objects[k];
+            const glm::vec3 center(objs[i].posRadius);
+            const float radius = objs[i].posRadius.w;
+            if (glm::distance(P, center) <= radius) return i;
+        }
+        return -1;
+    }
+
+    // Largest step allowed at the ray's position: a fraction of r, no deeper than
+    // a fifth of an object's radius past its surface, and no thicker than the disk
+    // slab while over the disk annulus.
+    float stepLimit(const Ray& ray, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                    const ObjectShells& shells) {
+        const glm::vec3 P(ray.x, ray.y, ray.z);
+        float hMax = geodesic::MAX_STEP * ray.r;
+        const int s = shells.shellOf(ray.r);
+        for (int k = shells.first[s]; k < shells.first[s] + shells.count[s]; ++k) {
+            const int i = shells.objects[k];
+            const float radius = objs[i].posRadius.w;
+            hMax = std::min(hMax, std::max(glm::distance(P, glm::vec3(objs[i].posRadius)) - radius, 0.2f * radius));
+        }
+        const float rho = std::sqrt(P.x*P.x + P.z*P.z);
+        if (rho > 0.5f * disk.r1 && rho < 2.0f * disk.r2)
+            hMax = std::min(hMax, std::max(std::fabs(P.y), disk.thickness));
+        return hMax;
+    }
+
+    // rk45Step: advances the ray by dL if the step passes the error test and
+    // returns the step to try next either way.
+    bool rk45Step(Ray& ray, float dL, float rs, float tolerance, float& dLNext) {
+        const geodesic::State<float> y{ray.r, ray.theta, ray.phi, ray.dr, ray.dtheta, ray.dphi};
+        geodesic::State<float> y5{};
+        const float err = geodesic::dormandPrince(y, ray.E, rs, dL, y5) / tolerance;
+        dLNext = geodesic::nextStep(dL, err);
+        if (err > 1.0f && dL > geodesic::MIN_STEP * ray.r) return false;
+
+        ray.r = y5.r; ray.theta = y5.theta; ray.phi = y5.phi;
+        ray.dr = y5.dr; ray.dtheta = y5.dtheta; ray.dphi = y5.dphi;
+
+        ray.x = ray.r * std::sin(ray.theta) * std::cos(ray.phi);
+        ray.y = ray.r * std::sin(ray.theta) * std::sin(ray.phi);
+        ray.z = ray.r * std::cos(ray.theta);
+        return true;
+    }
+
+    // Linear interpolation of the crossing inside the step, so long steps still
+    // put the hit at the right radius
+    bool crossesEquatorialPlane(const DiskParams& disk, glm::vec3 oldPos, glm::vec3 newPos, glm::vec3& hitPos) {
+        if (oldPos.y * newPos.y >= 0.0f) return false;
+        const float t = oldPos.y / (oldPos.y - newPos.y);
+        hitPos = oldPos + (newPos - oldPos) * t;
+        const float r = std::sqrt(hitPos.x*hitPos.x + hitPos.z*hitPos.z);
+        return r >= disk.r1 && r <= disk.r2;
+    }
+
+    Ray primaryRay(const CameraFrame& cam, float rs, sf::Vector2u size, unsigned px, unsigned py) {
+        const float u = (2.0f * ((float)px + 0.5f) / (float)size.x - 1.0f) * cam.aspect * cam.tanHalfFov;
+        const float v = (1.0f - 2.0f * ((float)py + 0.5f) / (float)size.y) * cam.tanHalfFov;
+        const glm::vec3 dir = glm::normalize(u * cam.right - v * cam.up + cam.forward);
+        return initRay(cam.pos, dir, rs);
+    }
+
+    std::uint8_t toUnorm8(float v) {
+        return (std::uint8_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+    }
+}
+
+CpuTracer::CpuTracer(ThreadPool& pool) : pool(pool) { }
+
+glm::vec4 CpuTracer::shade(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                           HitClass hit, glm::vec3 P, int object) {
+    switch (hit) {
+        case HitClass::Disk: {
+            const float r = glm::length(P) / disk.r2;
+            return {1.0f, r, 0.2f, r};
+        }
+        case HitClass::BlackHole:
+            return {0.0f, 0.0f, 0.0f, 1.0f};
+        case HitClass::Object: {
+            const glm::vec4 objectColor = objs[object].color;
+            const glm::vec3 N = glm::normalize(P - glm::vec3(objs[object].posRadius));
+            const glm::vec3 V = glm::normalize(cam.pos - P);
+            constexpr float ambient = 0.1f;
+            const float diff = std::max(glm::dot(N, V), 0.0f);
+            const float intensity = ambient + (1.0f - ambient) * diff;
+            return {glm::vec3(objectColor) * intensity, objectColor.w};
+        }
+        default:
+            return glm::vec4(0.0f);
+    }
+}
+
+glm::vec4 CpuTracer::tracePixel(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                                float tolerance, sf::Vector2u size, unsigned px, unsigned py) const {
+    Ray ray = primaryRay(cam, disk.r_s, size, px, py);
+    glm::vec3 prevPos(ray.x, ray.y, ray.z);
+    glm::vec3 diskPos(0.0f);
+    float lambda = 0.0f;
+
+    HitClass hit = HitClass::Escape;
+    int object = -1;
+
+    ObjectShells shells;
+    shells.build(objs, disk.r_s);
+
+    const int steps = cam.moving ? movingSteps : staticSteps;
+    const float lambdaMax = (float)steps * D_LAMBDA;
+    const float escapeR = escapeRadius(disk, shells.outer);
+    float dL = 0.01f * ray.r;
+    for (int i = 0; i < steps && lambda < lambdaMax; ++i) {
+        if (intercept(ray, disk.r_s)) { hit = HitClass::BlackHole; break; }
+        const float h = std::min(dL, stepLimit(ray, disk, objs, shells));
+        if (!rk45Step(ray, h, disk.r_s, tolerance, dL)) continue;
+        lambda += h;
+
+        const glm::vec3 newPos(ray.x, ray.y, ray.z);
+        if (crossesEquatorialPlane(disk, prevPos, newPos, diskPos)) { hit = HitClass::Disk; break; }
+        if ((object = interceptObject(ray, objs, shells)) >= 0) { hit = HitClass::Object; break; }
+        prevPos = newPos;
+        if (ray.r > escapeR && ray.dr > 0.0f) break;
+    }
+
+    const glm::vec3 P = hit == HitClass::Disk ? diskPos : glm::vec3(ray.x, ray.y, ray.z);
+    return shade(cam, disk, objs, hit, P, object);
+}
+
+void CpuTracer::render(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                       float tolerance, sf::Vector2u size, std::vector<std::uint8_t>& rgba,
+                       unsigned stride, sf::Vector2u offset, bool fillBlocks) {
+    rgba.resize((size_t)size.x * size.y * 4);
+    if (offset.x >= size.x || offset.y >= size.y) return;
+
+    // tiles are laid over the traced samples, pixel = sample * stride + offset
+    ObjectShells shells;
+    shells.build(objs, disk.r_s);
+
+    const sf::Vector2u samples((size.x - offset.x + stride - 1) / stride, (size.y - offset.y + stride - 1) / stride);
+    const int steps = cam.moving ? movingSteps : staticSteps;
+    const unsigned tilesX = (samples.x + tileSize - 1) / tileSize;
+    const unsigned tilesY = (samples.y + tileSize - 1) / tileSize;
+    pool.parallelFor((size_t)tilesX * tilesY, [&](size_t tile) {
+        const unsigned x0 = (unsigned)(tile % tilesX) * tileSize;
+        const unsigned y0 = (unsigned)(tile / tilesX) * tileSize;
+        const unsigned x1 = std::min(x0 + tileSize, samples.x);
+        const unsigned y1 = std::min(y0 + tileSize, samples.y);
+
+        // one packet covers consecutive samples of a tile row
+        RayPacket packet;
+        for (unsigned y = y0; y < y1; ++y) {
+            const unsigned py = y * stride + offset.y;
+            for (unsigned xs = x0; xs < x1; xs += RayPacket::width) {
+                const int count = (int)std::min<unsigned>(RayPacket::width, x1 - xs);
+                for (int lane = 0; lane < RayPacket::width; ++lane) {
+                    // spare lanes repeat the last pixel so they hold sane values
+                    const unsigned px = (xs + std::min(lane, count - 1)) * stride + offset.x;
+                    const Ray ray = primaryRay(cam, disk.r_s, size, px, py);
+                    packet.r[lane] = ray.r;
+                    packet.theta[lane] = ray.theta;
+                    packet.phi[lane] = ray.phi;
+                    packet.dr[lane] = ray.dr;
+                    packet.dtheta[lane] = ray.dtheta;
+                    packet.dphi[lane] = ray.dphi;
+                    packet.E[lane] = ray.E;
+                    packet.L[lane] = ray.L;
+                }
+                integratePacket(packet, count, disk, objs, shells, steps, tolerance);
+
+                for (int lane = 0; lane < count; ++lane) {
+                    const glm::vec3 P(packet.x[lane], packet.y[lane], packet.z[lane]);
+                    const glm::vec4 c = shade(cam, disk, objs, packet.hit[lane], P, packet.object[lane]);
+                    const std::uint8_t texel[4] = {toUnorm8(c.x), toUnorm8(c.y), toUnorm8(c.z), toUnorm8(c.w)};
+
+                    const unsigned px = (xs + lane) * stride + offset.x;
+                    const unsigned bx0 = fillBlocks ? px - offset.x : px, by0 = fillBlocks ? py - offset.y : py;
+                    const unsigned bx1 = fillBlocks ? std::min(bx0 + stride, size.x) : px + 1;
+                    const unsigned by1 = fillBlocks ? std::min(by0 + stride, size.y) : py + 1;
+                    for (unsigned by = by0; by < by1; ++by)
+                        for (unsigned bx = bx0; bx < bx1; ++bx)
+                            std::copy_n(texel, 4, &rgba[((size_t)by * size.x + bx) * 4]);
+                }
+            }
+        }
+    });
+}
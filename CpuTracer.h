@@ -0,0 +1,47 @@
+#ifndef BLACKHOLESFML_CPUTRACER_H
+#define BLACKHOLESFML_CPUTRACER_H
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec4.hpp>
+#include <SFML/System/Vector2.hpp>
+
+#include "FrameParams.h"
+#include "ObjectData.h"
+#include "RayPacket.h"
+#include "ThreadPool.h"
+
+// CPU port of geodesicComp (shaders/geodesic.shader.h). Renders 16x16 tiles,
+// the same footprint as one compute workgroup, spread over a work-stealing pool.
+// Inside a tile rays are stepped RayPacket::width at a time; tracePixel is the
+// plain scalar path, kept as the reference.
+class CpuTracer {
+public:
+    static constexpr unsigned tileSize = 16;
+
+    // step budget of render() and tracePixel(), still and moving camera, like geodesicComp's MAX_STEPS
+    int staticSteps = 60000;
+    int movingSteps = 48000;
+
+    explicit CpuTracer(ThreadPool& pool);
+
+    // Fills rgba with size.x * size.y RGBA8 pixels, row 0 on top (same as imageStore).
+    // tolerance is the local error bound of the adaptive integrator (see Integrator.h).
+    // With stride > 1 only pixel offset of every stride x stride block is traced and
+    // the rest of rgba is kept; fillBlocks copies that sample over its whole block.
+    void render(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                float tolerance, sf::Vector2u size, std::vector<std::uint8_t>& rgba,
+                unsigned stride = 1, sf::Vector2u offset = {0, 0}, bool fillBlocks = false);
+
+    glm::vec4 tracePixel(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                         float tolerance, sf::Vector2u size, unsigned px, unsigned py) const;
+
+    // colour of a ray that stopped at P, as geodesicComp writes it
+    static glm::vec4 shade(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                           HitClass hit, glm::vec3 P, int object);
+
+private:
+    ThreadPool& pool;
+};
+
+#endif //BLACKHOLESFML_CPUTRACER_H
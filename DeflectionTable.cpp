@@ -0,0 +1,73 @@
+#include "DeflectionTable.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "FrameParams.h"
+#include "Integrator.h"
+
+namespace {
+    constexpr float PI = 3.14159265f;
+    // finer than geodesic::MAX_STEP so that r(psi) is well resolved between columns
+    constexpr float TABLE_STEP = 0.02f;
+
+    float columnPsi(int column) {
+        return DeflectionTable::psiMax * (float)column / (float)(DeflectionTable::psiSamples - 1);
+    }
+}
+
+void DeflectionTable::build(float camRadius, float r_s, float tolerance, ThreadPool& pool) {
+    radius.assign((size_t)angleSamples * psiSamples, 0.0f);
+    rows.assign(angleSamples, glm::vec4(0.0f));
+
+    pool.parallelFor(angleSamples, [&](size_t row) {
+        const float alpha = PI * (float)row / (float)(angleSamples - 1);
+
+        // initRay in the orbital plane: theta = pi/2, phi is the swept angle psi
+        geodesic::State<float> y{camRadius, 0.5f * PI, 0.0f,
+                                 std::cos(alpha), 0.0f, std::sin(alpha) / camRadius};
+        const float f = 1.0f - r_s / y.r;
+        const float E = f * std::sqrt(y.dr * y.dr / f + y.r * y.r * y.dphi * y.dphi);
+
+        float* out = &radius[row * psiSamples];
+        out[0] = y.r;
+        int next = 1;
+
+        constexpr int steps = 60000;
+        const float lambdaMax = (float)steps * D_LAMBDA;
+        float lambda = 0.0f;
+        float dL = 0.01f * y.r;
+        bool captured = false;
+        for (int i = 0; i < steps && lambda < lambdaMax; ++i) {
+            if (y.r <= r_s) { captured = true; break; }
+
+            const float h = std::min(dL, TABLE_STEP * y.r);
+            geodesic::State<float> y5{};
+            const float err = geodesic::dormandPrince(y, E, r_s, h, y5) / tolerance;
+            dL = geodesic::nextStep(h, err);
+            if (err > 1.0f && h > geodesic::MIN_STEP * y.r) continue;
+
+            // resample onto the columns swept by this step
+            while (next < psiSamples && columnPsi(next) <= y5.phi) {
+                const float t = (columnPsi(next) - y.phi) / (y5.phi - y.phi);
+                out[next++] = y.r + (y5.r - y.r) * t;
+            }
+            y = y5;
+            lambda += h;
+            if (y.phi >= psiMax || y.r > ESCAPE_R) break;
+        }
+        std::fill(out + next, out + psiSamples, y.r);
+
+        rows[row] = glm::vec4(std::min(y.phi, psiMax),
+                              captured ? 1.0f : 0.0f,
+                              y.phi + std::atan2(y.r * y.dphi, y.dr) - alpha,
+                              0.0f);
+    });
+
+    cameraRadius = camRadius;
+    holeRadius = r_s;
+}
+
+bool DeflectionTable::isBuiltFor(float camRadius, float r_s) const {
+    return cameraRadius > 0.0f && std::fabs(camRadius - cameraRadius) <= 1e-4f * camRadius && r_s == holeRadius;
+}
@@ -0,0 +1,36 @@
+#ifndef BLACKHOLESFML_DEFLECTIONTABLE_H
+#define BLACKHOLESFML_DEFLECTIONTABLE_H
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include "ThreadPool.h"
+
+// Precomputed light paths for one camera radius. A Schwarzschild geodesic stays
+// in the plane spanned by the radial direction and the launch direction, so it
+// is fully described by the launch angle alpha (from the outward radial) and
+// r(psi) along the swept angle psi in that plane. deflectionComp rotates each
+// pixel's plane into 3D and walks r(psi) instead of integrating the ray.
+class DeflectionTable {
+public:
+    static constexpr int angleSamples = 2048; // rows, alpha in [0, pi]
+    static constexpr int psiSamples   = 1024; // columns, psi in [0, psiMax]
+    static constexpr float psiMax     = 4.0f * 3.14159265f;
+
+    float cameraRadius = 0.0f; // radius the table was built for, 0 = never built
+    float holeRadius = 0.0f;   // and the hole's r_s
+
+    // angleSamples x psiSamples, r(psi); past the end of a path the last radius repeats
+    std::vector<float> radius;
+    // per row: psi where the path ends, captured by the horizon (0/1),
+    // total deflection of escaping rays, unused
+    std::vector<glm::vec4> rows;
+
+    // Integrates every row with the adaptive geodesicComp scheme over the same
+    // affine reach as a static frame (60000 * D_LAMBDA).
+    void build(float camRadius, float r_s, float tolerance, ThreadPool& pool);
+
+    [[nodiscard]] bool isBuiltFor(float camRadius, float r_s) const;
+};
+
+#endif //BLACKHOLESFML_DEFLECTIONTABLE_H
@@ -1,14 +1,54 @@
 #include "Engine.h"
+#include "shaders/adaptive.shader.h"
 #include "shaders/blit.shader.h"
+#include "shaders/deflection.shader.h"
 #include "shaders/grid.shader.h"
 #include "shaders/geodesic.shader.h"
+#include "shaders/progressive.shader.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 
-Engine::Engine(const sf::Vector2u& initialSize) {
+namespace {
+    // 4x4 Bayer order, consecutive phases land far apart inside a block
+    constexpr unsigned samplePattern[Engine::sampleStride * Engine::sampleStride][2] = {
+        {0, 0}, {2, 2}, {2, 0}, {0, 2}, {1, 1}, {3, 3}, {3, 1}, {1, 3},
+        {1, 0}, {3, 2}, {3, 0}, {1, 2}, {0, 1}, {2, 3}, {2, 1}, {0, 3},
+    };
+    constexpr unsigned samplePhases = Engine::sampleStride * Engine::sampleStride;
+    static_assert(Engine::sampleStride == 4, "classifyComp assumes a coarse grid of stride 4");
+
+    GLuint groups(unsigned size, unsigned localSize = 16) {
+        return (size + localSize - 1) / localSize;
+    }
+
+    static_assert(sizeof(ObjectData) == 48, "ObjectData is the std430 Object of the tracing shaders");
+
+    // the bound GL_SHADER_STORAGE_BUFFER holds at least size bytes, contents are dropped on growth
+    void reserveStorage(GLsizeiptr& capacity, GLsizeiptr size) {
+        if (size <= capacity) return;
+        capacity = std::max(size, capacity + capacity / 2);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // src with defines inserted right after its #version line
+    std::string withDefines(const char* src, const char* defines) {
+        std::string out = src;
+        out.insert(out.find('\n', out.find("#version")) + 1, defines);
+        return out;
+    }
+
+    // geodesicComp's workgroup side, see LOCAL_SIZE there
+    unsigned traceLocalSize(unsigned requested) {
+        return requested == 8 ? 8 : 16;
+    }
+}
+
+Engine::Engine(const sf::Vector2u& initialSize) : windowSize(initialSize), computeSize(initialSize) {
     window = new sf::RenderWindow(sf::VideoMode(initialSize), "Black Hole (SFML + OpenGL)");
     window->setVerticalSyncEnabled(true);
 
@@ -30,92 +70,143 @@ Engine::Engine(const sf::Vector2u& initialSize) {
         std::exit(EXIT_FAILURE);
     }
 
-    if (!blitShader.loadFromMemory(blitVert, blitFraq)) {
+    if (!blitShader.loadFromMemory(blitVert, blitFraq) || !blurShader.loadFromMemory(blitVert, blurFraq)) {
         std::cerr << "Failed to load blit shaders" << std::endl;
         std::exit(EXIT_FAILURE);
     }
-    computeProgram = CreateComputeProgram(geodesicComp);
+    hasCompute = GLEW_VERSION_4_3;
+    if (hasCompute) {
+        programCache = std::make_unique<ProgramCache>(ProgramCache::defaultDirectory());
+        const ProgramCache& cache = *programCache;
+        reprojectProgram = CreateComputeProgram(reprojectComp, cache);
+        fillProgram = CreateComputeProgram(fillComp, cache);
+        classifyProgram = CreateComputeProgram(classifyComp, cache);
+    } else {
+        std::cout << "No OpenGL 4.3 compute shaders, using the CPU tracer" << std::endl;
+        useCpuTracer = true;
+    }
 
     genBuffers();
     genQuadVAO();
-
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, computeSize.x, computeSize.y, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    allocateTargets();
 }
 
 Engine::~Engine() {
     if (!window) return;
+    texturePool.clear();
+    traceTiles.destroy();
+    for (BufferRing* ring : {&cameraUBO, &diskUBO, &objectsRing, &shellsRing})
+        ring->destroy();
+    for (GLuint* ssbo : {&waveRaysBuffer, &waveListsBuffer}) {
+        if (*ssbo) glDeleteBuffers(1, ssbo);
+        *ssbo = 0;
+    }
     window->close();
     delete window;
     window = nullptr;
 }
 
 void Engine::generateGrid(const std::vector<ObjectData>& objs) {
-    constexpr int gridSize = 25;
-    constexpr double c = 299792458.0;
-    constexpr double G = 6.67430e-11;
-
-    std::vector<glm::vec3> vertices;
-    std::vector<GLuint> indices;
+    if (builtGridCells != gridCells) {
+        buildGridMesh();
+        gridMasses.clear(); // heights follow the new vertices
+    }
 
-    for (int z = 0; z <= gridSize; ++z) {
-        for (int x = 0; x <= gridSize; ++x) {
-            constexpr float spacing = 1e10f;
-            float worldX = ((float)x - (float)gridSize / 2.f) * spacing;
-            float worldZ = ((float)z - (float)gridSize / 2.f) * spacing;
+    bool dirty = gridMasses.size() != objs.size();
+    for (size_t i = 0; !dirty && i < objs.size(); ++i)
+        dirty = gridMasses[i] != gridMass(objs[i]);
+    if (!dirty) return;
+
+    gridMasses.resize(objs.size());
+    for (size_t i = 0; i < objs.size(); ++i)
+        gridMasses[i] = gridMass(objs[i]);
+
+    const bool cpuHeights = gridMasses.size() > maxGridMasses;
+    gridShader.setUniform("cpuHeights", cpuHeights);
+    if (!cpuHeights) {
+        sf::Glsl::Vec4 masses[maxGridMasses];
+        for (size_t i = 0; i < gridMasses.size(); ++i)
+            masses[i] = {gridMasses[i].x, gridMasses[i].y, gridMasses[i].z, gridMasses[i].w};
+        gridShader.setUniform("numMasses", (int)gridMasses.size());
+        gridShader.setUniformArray("masses", masses, maxGridMasses);
+        return;
+    }
 
+    const int side = gridCells + 1;
+    gridHeights.resize((size_t)side * side);
+    workers.parallelFor(side, [&](size_t z) {
+        for (int x = 0; x < side; ++x) {
+            const glm::vec2 p = gridVertex(x, (int)z);
             float y = 0.0f;
-            for (const auto& obj : objs) {
-                const auto objPos = glm::vec3(obj.posRadius);
-                const double mass = obj.mass;
-                const double r_s = 2.0 * G * mass / (c * c);
-                const double dx = worldX - objPos.x;
-                const double dz = worldZ - objPos.z;
-
-                if (const double dist = std::sqrt(dx*dx + dz*dz); dist > r_s) {
-                    const double deltaY = 2.0 * std::sqrt(r_s * (dist - r_s));
-                    y += static_cast<float>(deltaY) - 3e10f;
-                } else {
-                    y += 2.0f * static_cast<float>(std::sqrt(r_s * r_s)) - 3e10f;
-                }
+            for (const glm::vec4& m : gridMasses) {
+                const float dist = glm::distance(p, glm::vec2(m.x, m.z));
+                y += (dist > m.w ? 2.0f * std::sqrt(m.w * (dist - m.w)) : 2.0f * m.w) - 3e10f;
             }
-            vertices.emplace_back(worldX, y, worldZ);
+            gridHeights[z * side + x] = y;
         }
-    }
+    });
+
+    glBindVertexArray(gridVAO);
+    if (gridHeightVBO == 0) glGenBuffers(1, &gridHeightVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gridHeightVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridHeights.size() * sizeof(float), gridHeights.data(), GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)nullptr);
+    glBindVertexArray(0);
+}
 
-    for (int z = 0; z < gridSize; ++z) {
-        for (int x = 0; x < gridSize; ++x) {
-            const int i = z * (gridSize + 1) + x;
+glm::vec2 Engine::gridVertex(int x, int z) const {
+    const float spacing = gridExtent / (float)gridCells;
+    return {((float)x - (float)gridCells / 2.f) * spacing, ((float)z - (float)gridCells / 2.f) * spacing};
+}
+
+glm::vec4 Engine::gridMass(const ObjectData& obj) {
+    constexpr double c = 299792458.0;
+    constexpr double G = 6.67430e-11;
+    return {glm::vec3(obj.posRadius), (float)(2.0 * G * obj.mass / (c * c))};
+}
+
+void Engine::buildGridMesh() {
+    std::vector<glm::vec2> vertices;
+    std::vector<GLuint> indices;
+
+    for (int z = 0; z <= gridCells; ++z)
+        for (int x = 0; x <= gridCells; ++x)
+            vertices.push_back(gridVertex(x, z));
+
+    for (int z = 0; z < gridCells; ++z) {
+        for (int x = 0; x < gridCells; ++x) {
+            const int i = z * (gridCells + 1) + x;
             indices.push_back(i); indices.push_back(i + 1);
-            indices.push_back(i); indices.push_back(i + gridSize + 1);
+            indices.push_back(i); indices.push_back(i + gridCells + 1);
         }
     }
 
-    if (gridVAO == 0) glGenVertexArrays(1, &gridVAO);
-    if (gridVBO == 0) glGenBuffers(1, &gridVBO);
-    if (gridEBO == 0) glGenBuffers(1, &gridEBO);
+    if (gridVAO == 0) {
+        glGenVertexArrays(1, &gridVAO);
+        glGenBuffers(1, &gridVBO);
+        glGenBuffers(1, &gridEBO);
+    }
 
     glBindVertexArray(gridVAO);
     glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)nullptr);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)nullptr);
+    glDisableVertexAttribArray(1); // old heights no longer match, generateGrid re-enables it
 
     gridIndexCount = (int)indices.size();
+    builtGridCells = gridCells;
     glBindVertexArray(0);
 }
 
 void Engine::drawGrid(const Camera& camera) {
     glm::mat4 view = lookAt(camera.position(), camera.target, glm::vec3(0,1,0));
     glm::mat4 proj = glm::perspective(glm::radians(60.0f),
-        float(window->getSize().x)/float(window->getSize().y), 1e9f, 1e14f);
+        float(windowSize.x)/float(windowSize.y), 1e9f, 1e14f);
     glm::mat4 viewProj = proj * view;
 
     sf::Shader::bind(&gridShader);
@@ -137,15 +228,20 @@ void Engine::drawGrid(const Camera& camera) {
 }
 
 void Engine::drawFullScreenQuad() {
+    blurImage();
+
     blitShader.setUniform("u_texture", sf::Shader::CurrentTexture);
+    blitShader.setUniform("u_blurred", 1);
     blitShader.setUniform("u_textureSize", sf::Vector2f(computeSize));
-    blitShader.setUniform("u_sigma", 1.f);
-    blitShader.setUniform("u_sharpness", 0.4f);
+    blitShader.setUniform("u_storageSize", sf::Vector2f(storageSize));
+    blitShader.setUniform("u_sharpness", blitSharpness);
 
     sf::Shader::bind(&blitShader);
 
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, blurTextures[1]);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    glBindTexture(GL_TEXTURE_2D, frames[current]);
 
     glDisable(GL_DEPTH_TEST);
     glBindVertexArray(quadVAO);
@@ -156,7 +252,39 @@ void Engine::drawFullScreenQuad() {
     sf::Shader::bind(nullptr);
 }
 
-GLuint Engine::CreateComputeProgram(const char* src) {
+void Engine::blurImage() {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, blurFBO);
+    glViewport(0, 0, (GLsizei)computeSize.x, (GLsizei)computeSize.y);
+
+    blurShader.setUniform("u_texture", sf::Shader::CurrentTexture);
+    blurShader.setUniform("u_textureSize", sf::Vector2f(computeSize));
+    blurShader.setUniform("u_storageSize", sf::Vector2f(storageSize));
+    blurShader.setUniform("u_sigma", blitSigma);
+    sf::Shader::bind(&blurShader);
+
+    glDisable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(quadVAO);
+    const GLuint sources[2] = {frames[current], blurTextures[0]};
+    for (int pass = 0; pass < 2; ++pass) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTextures[pass], 0);
+        blurShader.setUniform("u_direction", pass == 0 ? sf::Vector2f(1.f, 0.f) : sf::Vector2f(0.f, 1.f));
+        glBindTexture(GL_TEXTURE_2D, sources[pass]);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 6);
+    }
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    sf::Shader::bind(nullptr);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+GLuint Engine::CreateComputeProgram(const char* src, const ProgramCache& cache) {
+    if (const GLuint cached = cache.load(src)) return cached;
+
     const GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
     glShaderSource(cs, 1, &src, nullptr);
     glCompileShader(cs);
@@ -171,6 +299,7 @@ GLuint Engine::CreateComputeProgram(const char* src) {
 
     GLuint prog = glCreateProgram();
     glAttachShader(prog, cs);
+    if (cache.enabled()) glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(prog);
     glGetProgramiv(prog, GL_LINK_STATUS, &ok);
     if (!ok) {
@@ -181,29 +310,327 @@ GLuint Engine::CreateComputeProgram(const char* src) {
         exit(EXIT_FAILURE);
     }
     glDeleteShader(cs);
+    cache.store(src, prog);
     return prog;
 }
 
 void Engine::dispatchCompute(const Camera& cam, const BlackHole& hole, const std::vector<ObjectData>& objs) {
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, computeSize.x, computeSize.y,
-        0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    allocateTargets();
+
+    const CameraFrame frame = cameraFrame(cam);
+    const bool changed = !hasHistory || objectsMoved || frame.pos != lastFrame.pos
+                         || frame.forward != lastFrame.forward || frame.moving != lastFrame.moving;
+    objectsMoved = false;
+    const bool gpu = !useCpuTracer && hasCompute;
+    const bool adaptive = gpu && useAdaptiveSampling;
+    const sf::Vector2u offset = adaptive ? sf::Vector2u(0, 0)
+                                         : sf::Vector2u(samplePattern[phase][0], samplePattern[phase][1]);
+    // the adaptive pass classifies the whole coarse image at once, the table lookup is cheap
+    const bool wavefront = gpu && useWavefront && !adaptive && !useDeflectionTable && !usePlanarKernel;
+    const bool sliced = gpu && !adaptive && !useDeflectionTable && !wavefront;
+    // a sliced pass goes on across view changes, restarting it on every moving frame
+    // would only ever trace the centre tiles; without history there is nothing to keep
+    if (!hasHistory) traceTiles.restart();
+    if (changed) {
+        tracedPhases = 0;
+        passStale = passStale || (sliced && traceTiles.started());
+        holesPending = true;
+    }
+
+    if (!gpu) {
+        if (!cpuTracer) cpuTracer = std::make_unique<CpuTracer>(workers);
+        cpuTracer->staticSteps = staticSteps;
+        cpuTracer->movingSteps = movingSteps;
+        // no reprojection here, a changed view restarts from block-sized samples
+        cpuTracer->render(frame, showDisk ? diskParams(hole) : DiskParams::hidden(hole.r_s), objs, tolerance, computeSize, cpuPixels,
+                          sampleStride, offset, changed);
+
+        glBindTexture(GL_TEXTURE_2D, frames[current]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, computeSize.x, computeSize.y,
+            GL_RGBA, GL_UNSIGNED_BYTE, cpuPixels.data());
+    } else {
+        uploadCameraUBO(cam);
+        uploadDiskUBO(hole);
+        uploadObjects(objs, (float)hole.r_s);
+        if (changed && !adaptive) reproject(frame, glm::distance(cam.position(), cam.target));
+
+        GLuint program = tracerProgram(frame.moving, hole, objs.size(), wavefront);
+        unsigned localSize = traceLocalSize(traceGroupSize);
+        if (useDeflectionTable) {
+            program = deflectionTracer(hole);
+            localSize = 16;
+            updateDeflectionTable(glm::length(cam.position()), (float)hole.r_s);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, orbitRadiusTex);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, orbitEndTex);
+            glActiveTexture(GL_TEXTURE0);
+        }
 
-    glUseProgram(computeProgram);
-    uploadCameraUBO(cam);
-    uploadDiskUBO(hole);
-    uploadObjectsUBO(objs);
-    glUniform2i(glGetUniformLocation(computeProgram, "texSize"), computeSize.x, computeSize.y);
+        glUseProgram(program);
+        glUniform2i(glGetUniformLocation(program, "texSize"), computeSize.x, computeSize.y);
+        glUniform1f(glGetUniformLocation(program, "tolerance"), tolerance);
+        glUniform1f(glGetUniformLocation(program, "psiMax"), DeflectionTable::psiMax);
+        glUniform2i(glGetUniformLocation(program, "sampleOffset"), offset.x, offset.y);
+        glUniform1i(glGetUniformLocation(program, "sampleStride"), sampleStride);
+        glUniform1i(glGetUniformLocation(program, "refineTiles"), GL_FALSE);
+
+        glBindImageTexture(0, frames[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glBindImageTexture(2, hitImage, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, refineTilesBuffer);
+
+        const sf::Vector2u grid((computeSize.x + sampleStride - 1) / sampleStride,
+                                (computeSize.y + sampleStride - 1) / sampleStride);
+        if (wavefront) {
+            traceWavefront(program, grid.x * grid.y, frame.moving ? movingSteps : staticSteps);
+        } else if (sliced) {
+            const GLint tileOrigin = glGetUniformLocation(program, "tileOrigin");
+            traceTiles.layout(grid);
+            traceTiles.run(sliceBudgetMs, [&](sf::Vector2u origin, sf::Vector2u size) {
+                glUniform2i(tileOrigin, origin.x, origin.y);
+                glDispatchCompute(groups(size.x, localSize), groups(size.y, localSize), 1);
+            });
+        } else {
+            glUniform2i(glGetUniformLocation(program, "tileOrigin"), 0, 0);
+            glDispatchCompute(groups(grid.x, localSize), groups(grid.y, localSize), 1);
+        }
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        // a hole may only copy a sample of this pass once the pass has traced it
+        if (adaptive) refineEdges(program);
+        else if (holesPending && (!sliced || traceTiles.finished())) fillHoles(offset);
+    }
+
+    lastFrame = frame;
+    hasHistory = true;
+    if (!sliced || traceTiles.finished()) {
+        phase = (phase + 1) % samplePhases;
+        tracedPhases = adaptive ? samplePhases : passStale ? 0 : std::min(tracedPhases + 1, samplePhases);
+        passStale = false;
+        holesPending = false;
+        traceTiles.restart();
+    }
+    isTextureReady = tracedPhases == samplePhases;
+}
+
+GLuint Engine::tracerProgram(bool moving, const BlackHole& hole, size_t objectCount, bool wavefront) {
+    // small scenes get a loop bound the compiler can unroll
+    const size_t objects = objectCount == 0 ? 0 : objectCount <= 4 ? 4 : objectCount <= 16 ? 16 : 1u << 20;
+    char defines[256];
+    std::snprintf(defines, sizeof(defines),
+                  "#define LOCAL_SIZE %u\n#define MAX_STEPS %d\n#define MAX_OBJECTS %d\n"
+                  "#define DISK %d\n#define PLANAR %d\n#define SCHWARZSCHILD_RADIUS %.9e\n#define WAVEFRONT %d\n",
+                  traceLocalSize(traceGroupSize), moving ? movingSteps : staticSteps,
+                  (int)objects, showDisk ? 1 : 0,
+                  usePlanarKernel ? 1 : 0, hole.r_s, wavefront ? 1 : 0);
+
+    GLuint& program = tracerPrograms[defines];
+    if (program == 0) program = CreateComputeProgram(withDefines(geodesicComp, defines).c_str(), *programCache);
+    return program;
+}
+
+GLuint Engine::deflectionTracer(const BlackHole& hole) {
+    if (deflectionProgram != 0 && deflectionRs == hole.r_s && deflectionDisk == showDisk) return deflectionProgram;
+    char defines[96];
+    std::snprintf(defines, sizeof(defines), "#define SCHWARZSCHILD_RADIUS %.9e\n#define DISK %d\n",
+                  hole.r_s, showDisk ? 1 : 0);
+    if (deflectionProgram != 0) glDeleteProgram(deflectionProgram);
+    deflectionProgram = CreateComputeProgram(withDefines(deflectionComp, defines).c_str(), *programCache);
+    deflectionRs = hole.r_s;
+    deflectionDisk = showDisk;
+    return deflectionProgram;
+}
 
-    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+void Engine::readTraced(std::vector<std::uint8_t>& rgba) {
+    // the targets are pooled storage, only the top-left computeSize part is used
+    std::vector<std::uint8_t> storage((size_t)storageSize.x * storageSize.y * 4);
+    glBindTexture(GL_TEXTURE_2D, frames[current]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, storage.data());
+
+    rgba.resize((size_t)targetSize.x * targetSize.y * 4);
+    for (unsigned y = 0; y < targetSize.y; ++y)
+        std::copy_n(&storage[(size_t)y * storageSize.x * 4], (size_t)targetSize.x * 4,
+                    &rgba[(size_t)y * targetSize.x * 4]);
+}
 
-    const auto groupsX = (GLuint)std::ceil((float)computeSize.x / 16.f);
-    const auto groupsY = (GLuint)std::ceil((float)computeSize.y / 16.f);
-    glDispatchCompute(groupsX, groupsY, 1);
+void Engine::invalidate() {
+    hasHistory = false;
+    isTextureReady = false;
+}
+
+void Engine::markObjectsMoved() {
+    objectsMoved = true;
+    isTextureReady = false;
+}
+
+void Engine::allocateTargets() {
+    if (targetSize == computeSize) return;
+
+    // within the same size bucket only the used part of the targets changes
+    const sf::Vector2u storage = TexturePool::storageSize(computeSize);
+    if (storage != storageSize) {
+        for (GLuint* tex : {&frames[0], &frames[1], &sampleState, &hitImage, &blurTextures[0], &blurTextures[1]}) {
+            texturePool.release(*tex);
+            *tex = 0;
+        }
+        frames[0] = texturePool.acquire(storage, GL_RGBA8);
+        frames[1] = texturePool.acquire(storage, GL_RGBA8);
+        sampleState = texturePool.acquire(storage, GL_R8UI);
+        blurTextures[0] = texturePool.acquire(storage, GL_RGBA8);
+        blurTextures[1] = texturePool.acquire(storage, GL_RGBA8);
+        if (blurFBO == 0) glGenFramebuffers(1, &blurFBO);
+
+        if (hasCompute) {
+            hitImage = texturePool.acquire(storage, GL_R32UI);
+            if (refineTilesBuffer == 0) glGenBuffers(1, &refineTilesBuffer);
+            if (waveRaysBuffer == 0) glGenBuffers(1, &waveRaysBuffer);
+            if (waveListsBuffer == 0) glGenBuffers(1, &waveListsBuffer);
+            // indirect dispatch args followed by one entry per 16x16 tile
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, refineTilesBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER,
+                         (3 + (GLsizeiptr)groups(storage.x) * groups(storage.y)) * sizeof(GLuint),
+                         nullptr, GL_DYNAMIC_DRAW);
+        }
+        storageSize = storage;
+    }
+
+    targetSize = computeSize;
+    invalidate();
+}
+
+void Engine::reproject(const CameraFrame& frame, float focusDistance) {
+    const GLuint history = frames[current];
+    current = 1 - current;
+
+    glUseProgram(reprojectProgram);
+    glUniform2i(glGetUniformLocation(reprojectProgram, "texSize"), computeSize.x, computeSize.y);
+    glUniform1i(glGetUniformLocation(reprojectProgram, "hasHistory"), hasHistory);
+    glUniform1f(glGetUniformLocation(reprojectProgram, "focusDistance"), focusDistance);
+    glUniform3fv(glGetUniformLocation(reprojectProgram, "prevPos"), 1, glm::value_ptr(lastFrame.pos));
+    glUniform3fv(glGetUniformLocation(reprojectProgram, "prevRight"), 1, glm::value_ptr(lastFrame.right));
+    glUniform3fv(glGetUniformLocation(reprojectProgram, "prevUp"), 1, glm::value_ptr(lastFrame.up));
+    glUniform3fv(glGetUniformLocation(reprojectProgram, "prevForward"), 1, glm::value_ptr(lastFrame.forward));
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, history);
+    glBindImageTexture(0, frames[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindImageTexture(1, sampleState, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8UI);
+
+    glDispatchCompute(groups(computeSize.x), groups(computeSize.y), 1);
     glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 }
 
-void Engine::uploadCameraUBO(const Camera& cam) const {
+void Engine::fillHoles(sf::Vector2u offset) {
+    glUseProgram(fillProgram);
+    glUniform2i(glGetUniformLocation(fillProgram, "texSize"), computeSize.x, computeSize.y);
+    glUniform2i(glGetUniformLocation(fillProgram, "sampleOffset"), offset.x, offset.y);
+    glUniform1i(glGetUniformLocation(fillProgram, "sampleStride"), sampleStride);
+
+    glBindImageTexture(0, frames[current], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+    glBindImageTexture(1, sampleState, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R8UI);
+
+    glDispatchCompute(groups(computeSize.x), groups(computeSize.y), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void Engine::refineEdges(GLuint traceProgram) {
+    constexpr GLuint emptyDispatch[3] = {0, 1, 1};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, refineTilesBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyDispatch), emptyDispatch);
+
+    glUseProgram(classifyProgram);
+    glUniform2i(glGetUniformLocation(classifyProgram, "texSize"), computeSize.x, computeSize.y);
+    glUniform1f(glGetUniformLocation(classifyProgram, "refineThreshold"), refineThreshold);
+    glBindImageTexture(0, frames[current], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+    glBindImageTexture(2, hitImage, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+
+    glDispatchCompute(groups(computeSize.x), groups(computeSize.y), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    glUseProgram(traceProgram);
+    glUniform1i(glGetUniformLocation(traceProgram, "refineTiles"), GL_TRUE);
+    glBindImageTexture(0, frames[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindImageTexture(2, hitImage, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, refineTilesBuffer);
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+// Pass 0 starts one ray per sampled pixel, every later one continues the rays the pass
+// before it listed, as many groups as it counted. The passes are issued blind, without
+// reading the count back: chunks double, so enough of them cover the step budget and an
+// empty list costs only an empty dispatch.
+void Engine::traceWavefront(GLuint program, unsigned rays, int steps) {
+    // std430 WaveRay of geodesicComp
+    constexpr GLsizeiptr rayBytes = 48;
+    constexpr GLsizeiptr headerBytes = 2 * 4 * sizeof(GLuint);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, waveRaysBuffer);
+    reserveStorage(waveRaysCapacity, rays * rayBytes);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, waveListsBuffer);
+    reserveStorage(waveListsCapacity, headerBytes + 2 * (GLsizeiptr)rays * sizeof(GLuint));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, waveRaysBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, waveListsBuffer);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, waveListsBuffer);
+
+    const unsigned localSize = traceLocalSize(traceGroupSize) * traceLocalSize(traceGroupSize);
+    glUniform1ui(glGetUniformLocation(program, "waveListStride"), rays);
+    const GLint init = glGetUniformLocation(program, "waveInit");
+    const GLint parity = glGetUniformLocation(program, "waveParity");
+    const GLint chunk = glGetUniformLocation(program, "waveSteps");
+
+    int chunkSteps = std::max(wavefrontChunk, 1);
+    for (int done = 0, pass = 0; done < steps; done += chunkSteps, chunkSteps *= 2, ++pass) {
+        const GLuint in = pass % 2;
+        constexpr GLuint emptyList[4] = {0, 1, 1, 0};
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (1 - in) * sizeof(emptyList), sizeof(emptyList), emptyList);
+
+        glUniform1i(init, pass == 0);
+        glUniform1ui(parity, in);
+        glUniform1i(chunk, chunkSteps);
+        if (pass == 0) glDispatchCompute(groups(rays, localSize), 1, 1);
+        else glDispatchComputeIndirect(in * sizeof(emptyList));
+        // the next pass reads this list and dispatches on its args, and the pass after
+        // it clears this list's header from the API
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+}
+
+void Engine::updateDeflectionTable(float camRadius, float r_s) {
+    if (deflection.isBuiltFor(camRadius, r_s)) return;
+    deflection.build(camRadius, r_s, tolerance, workers);
+
+    if (orbitRadiusTex == 0) {
+        glGenTextures(1, &orbitRadiusTex);
+        glGenTextures(1, &orbitEndTex);
+        for (const GLuint tex : {orbitRadiusTex, orbitEndTex}) {
+            glBindTexture(GL_TEXTURE_2D, tex);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, orbitRadiusTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, DeflectionTable::psiSamples, DeflectionTable::angleSamples,
+                 0, GL_RED, GL_FLOAT, deflection.radius.data());
+    glBindTexture(GL_TEXTURE_2D, orbitEndTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, DeflectionTable::angleSamples, 1,
+                 0, GL_RGBA, GL_FLOAT, deflection.rows.data());
+}
+
+CameraFrame Engine::cameraFrame(const Camera& cam) const {
+    return CameraFrame::lookAt(cam.position(), cam.target, 60.0f,
+        static_cast<float>(windowSize.x) / static_cast<float>(windowSize.y), cam.moving);
+}
+
+DiskParams Engine::diskParams(const BlackHole& hole) {
+    return DiskParams::around(hole.r_s);
+}
+
+void Engine::uploadCameraUBO(const Camera& cam) {
     struct UBOData {
         glm::vec3 pos; float _pad0;
         glm::vec3 right; float _pad1;
@@ -215,53 +642,56 @@ void Engine::uploadCameraUBO(const Camera& cam) const {
         int   _pad4;
     } data{};
 
-    glm::vec3 fwd = normalize(cam.target - cam.position());
-    glm::vec3 up = glm::vec3(0, 1, 0);
-    glm::vec3 right = normalize(cross(fwd, up));
-    up = cross(right, fwd);
-
-    data.pos = cam.position();
-    data.right = right;
-    data.up = up;
-    data.forward = fwd;
-    data.tanHalfFov = std::tan(glm::radians(60.0f * 0.5f));
-    data.moving = cam.moving ? 1 : 0;
-    data.aspect = static_cast<float>(window->getSize().x) / static_cast<float>(window->getSize().y);
-
-    glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UBOData), &data);
-}
-
-void Engine::uploadObjectsUBO(const std::vector<ObjectData>& objs) const {
-    struct UBOData {
-        int   numObjects;
-        float _pad0, _pad1, _pad2;
-        glm::vec4  posRadius[16];
-        glm::vec4  color[16];
-        float mass[16];
-    } data{};
+    const CameraFrame frame = cameraFrame(cam);
+    data.pos = frame.pos;
+    data.right = frame.right;
+    data.up = frame.up;
+    data.forward = frame.forward;
+    data.tanHalfFov = frame.tanHalfFov;
+    data.moving = frame.moving ? 1 : 0;
+    data.aspect = frame.aspect;
 
-    size_t count = std::min(objs.size(), size_t(16));
-    data.numObjects = static_cast<int>(count);
-    for (size_t i = 0; i < count; ++i) {
-        data.posRadius[i] = objs[i].posRadius;
-        data.color[i]     = objs[i].color;
-        data.mass[i]      = objs[i].mass;
-    }
+    cameraUBO.write(&data, sizeof(data));
+}
 
-    glBindBuffer(GL_UNIFORM_BUFFER, objectsUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+void Engine::uploadObjects(const ObjectData* objs, size_t count, float r_s) {
+    if (!hasCompute) return;
+
+    // numObjects, objectsOuter and padding, see geodesicComp
+    struct ObjectsHeader {
+        GLint count;
+        float outer;
+        GLint pad[2];
+    } header{(GLint)count, ObjectShells::outerRadius(objs, count), {0, 0}};
+    const bool moved = objectsRing.write({{&header, sizeof(header)},
+                                          {objs, (GLsizeiptr)(count * sizeof(ObjectData))}});
+    if (!moved && uploadedRs == r_s) return; // the shells follow the objects
+    uploadedRs = r_s;
+
+    ObjectShells& shells = objectShells;
+    shells.build(objs, count, r_s);
+
+    // broad phase, see ObjectShells.h
+    struct ShellsHeader {
+        float base;
+        float invLogGrowth;
+        glm::uvec2 ranges[ObjectShells::shellCount]; // first, count
+    } shellsHeader{};
+
+    shellsHeader.base = shells.base;
+    shellsHeader.invLogGrowth = shells.invLogGrowth;
+    for (int s = 0; s < ObjectShells::shellCount; ++s)
+        shellsHeader.ranges[s] = {shells.first[s], shells.count[s]};
+
+    shellsRing.write({{&shellsHeader, sizeof(shellsHeader)},
+                      {shells.objects.data(), (GLsizeiptr)(shells.objects.size() * sizeof(std::uint32_t))}});
 }
 
-void Engine::uploadDiskUBO(const BlackHole& hole) const {
-    float r1 = float(hole.r_s) * 2.2f;
-    float r2 = float(hole.r_s) * 5.2f;
-    float num = 2.0f;
-    float thickness = 1e9f;
-    float diskData[4] = { r1, r2, num, thickness };
+void Engine::uploadDiskUBO(const BlackHole& hole) {
+    const DiskParams disk = diskParams(hole);
+    float diskData[4] = { disk.r1, disk.r2, disk.num, disk.thickness };
 
-    glBindBuffer(GL_UNIFORM_BUFFER, diskUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(diskData), diskData);
+    diskUBO.write(diskData, sizeof(diskData));
 }
 
 void Engine::genQuadVAO() {
@@ -290,21 +720,12 @@ void Engine::genQuadVAO() {
 }
 
 void Engine::genBuffers() {
-    glGenBuffers(1, &cameraUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
-    glBufferData(GL_UNIFORM_BUFFER, 128, nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, cameraUBO);
-
-    glGenBuffers(1, &diskUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, diskUBO);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(float) * 4, nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 2, diskUBO);
-
-    glGenBuffers(1, &objectsUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, objectsUBO);
-    constexpr GLsizeiptr objUBOSize = sizeof(int) + 3*sizeof(float)
-                                      + 16*(sizeof(glm::vec4) + sizeof(glm::vec4))
-                                      + 16*sizeof(float);
-    glBufferData(GL_UNIFORM_BUFFER, objUBOSize, nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 3, objectsUBO);
+    cameraUBO.create(GL_UNIFORM_BUFFER, 1, 128);
+    diskUBO.create(GL_UNIFORM_BUFFER, 2, sizeof(float) * 4);
+
+    if (!hasCompute) return;
+    // binding 4 is RefineTiles; the object rings grow with the scene
+    objectsRing.create(GL_SHADER_STORAGE_BUFFER, 3, 4096);
+    shellsRing.create(GL_SHADER_STORAGE_BUFFER, 5, 4096);
+    uploadObjects(nullptr, 0, 1.0f); // no objects, no shells to place
 }
@@ -1,56 +1,189 @@
 #ifndef BLACKHOLESFML_ENGINE_H
 #define BLACKHOLESFML_ENGINE_H
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <GL/glew.h>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
 #include <SFML/Graphics/Shader.hpp>
 #include <SFML/Graphics/RenderWindow.hpp>
 
 #include "BlackHole.h"
+#include "BufferRing.h"
 #include "Camera.h"
+#include "CpuTracer.h"
+#include "DeflectionTable.h"
+#include "FrameParams.h"
 #include "ObjectData.h"
+#include "ObjectShells.h"
+#include "ProgramCache.h"
+#include "TexturePool.h"
+#include "ThreadPool.h"
+#include "TileScheduler.h"
 
 class Engine {
 public:
     // Window / context via SFML
     sf::RenderWindow* window = nullptr;
-    bool isTextureReady = false;
-
+    // size the view is drawn at (aspect of the camera, grid viewport); set by whoever
+    // owns the window's events, the render thread never asks the window itself
+    sf::Vector2u windowSize;
+    bool isTextureReady = false; // every pixel traced since the view last changed
+    bool useCpuTracer = false; // forced on when there is no GL 4.3 compute
+    float tolerance = 1e-5f;   // local error bound of the adaptive geodesic integrator
+    bool useDeflectionTable = false; // look rays up in DeflectionTable instead of integrating
+    // GPU only: trace a coarse grid, then only the 16x16 tiles where it disagrees
+    // (mixed hit classes or colours spread over refineThreshold), interpolate the rest
+    bool useAdaptiveSampling = false;
+    float refineThreshold = 0.1f;
+    bool showDisk = true;
+    // integrate U'' + U = 1.5 U^2 in each ray's plane instead of the 3D geodesic (GPU)
+    bool usePlanarKernel = false;
+    // 3D kernel, progressive only: trace in passes of wavefrontChunk steps (doubling each
+    // pass) over a compacted list of the rays still going, so the long orbits near the
+    // photon sphere no longer hold up whole workgroups of rays that finished early
+    bool useWavefront = false;
+    int wavefrontChunk = 256;
+    unsigned traceGroupSize = 16; // 8 or 16, workgroup side of the GPU trace
+    // GPU time the progressive trace may take per frame, a slower pass is spread over
+    // several frames in tiles (TileScheduler); 0 traces each pass in one go
+    float sliceBudgetMs = 50.f;
+    // step budget of a trace (MAX_STEPS of geodesicComp), smaller while the camera moves
+    int staticSteps = 60000;
+    int movingSteps = 48000;
+
+    // Each frame traces one pixel per sampleStride x sampleStride block and reprojects
+    // the rest from the previous frame, so a still view converges in sampleStride^2 frames.
+    static constexpr unsigned sampleStride = 4;
     sf::Vector2u computeSize{200, 150};
 
+    int gridCells = 25;   // cells per side of the spacetime grid, same extent at any density
+    float blitSigma = 1.f;     // gaussian of the unsharp mask, in traced texels
+    float blitSharpness = 0.4f; // unsharp mask amount on top of the edge-directed upscale
+
     explicit Engine(const sf::Vector2u& initialSize);
     ~Engine();
 
+    // cheap when the masses did not move, see gridVert
     void generateGrid(const std::vector<ObjectData>& objs);
     void drawGrid(const Camera& camera);
 
     void drawFullScreenQuad();
 
     void dispatchCompute(const Camera& cam, const BlackHole& hole, const std::vector<ObjectData>& objs);
+    // drops the accumulated image, e.g. after switching tracers
+    void invalidate();
+    // the objects moved: the image stays as history, but every pixel is traced again
+    void markObjectsMoved();
+    // the traced image, computeSize RGBA8 pixels with row 0 on top, as CpuTracer::render writes it
+    void readTraced(std::vector<std::uint8_t>& rgba);
+
+    // done by dispatchCompute, public so BlackHoleBench can time them alone;
+    // each one only writes when its data changed, see BufferRing
+    void uploadCameraUBO(const Camera& cam);
+    // ObjectData is the std430 layout of the Objects buffer, so objs goes in as is
+    // r_s places the broad-phase shells, see ObjectShells
+    void uploadObjects(const ObjectData* objs, size_t count, float r_s);
+    void uploadObjects(const std::vector<ObjectData>& objs, float r_s) { uploadObjects(objs.data(), objs.size(), r_s); }
+    void uploadDiskUBO(const BlackHole& hole);
+
+    [[nodiscard]] CameraFrame cameraFrame(const Camera& cam) const;
+    static DiskParams diskParams(const BlackHole& hole);
 
 private:
     // GL programs & buffers
-    GLuint texture = 0;
     sf::Shader gridShader;
     sf::Shader blitShader;
-    GLuint computeProgram = 0;
-
-    GLuint cameraUBO = 0;
-    GLuint diskUBO = 0;
-    GLuint objectsUBO = 0;
+    sf::Shader blurShader;
+    bool hasCompute = false; // GL 4.3 compute shaders; the tracers are compiled when first selected
+    // geodesicComp permutations by their #define block, compiled on first use
+    std::unordered_map<std::string, GLuint> tracerPrograms;
+    std::unique_ptr<ProgramCache> programCache;
+    GLuint deflectionProgram = 0; // for the hole of deflectionRs, with the disk if deflectionDisk
+    double deflectionRs = 0.0;
+    bool deflectionDisk = true;
+    GLuint reprojectProgram = 0;
+    GLuint fillProgram = 0;
+    GLuint classifyProgram = 0;
+
+    // progressive accumulation, frames[current] is the displayed image
+    GLuint frames[2] = {0, 0};
+    GLuint sampleState = 0; // r8ui, 0 = pixel has no history yet
+    int current = 0;
+    sf::Vector2u targetSize{0, 0};
+    sf::Vector2u storageSize{0, 0}; // of the targets, targetSize is their used part
+    TexturePool texturePool;
+    GLuint blurTextures[2] = {0, 0}; // horizontal, then both directions, see blurFraq
+    GLuint blurFBO = 0;
+    CameraFrame lastFrame{};
+    bool hasHistory = false;
+    unsigned phase = 0;        // next pixel of the block pattern
+    unsigned tracedPhases = 0; // traced since the view last changed
+    bool objectsMoved = false; // since the last dispatchCompute
+    // the view changed during the sliced pass in progress: its earlier tiles were traced
+    // for the old view, so the pass does not count, and its holes are filled once it ends
+    bool passStale = false;
+    bool holesPending = false;
+    GLuint hitImage = 0;          // r32ui hit class per pixel, see classifyComp
+    GLuint refineTilesBuffer = 0; // indirect dispatch args + tiles to refine
+    TileScheduler traceTiles;     // of the current phase
+    GLuint waveRaysBuffer = 0;    // ray state between wavefront passes
+    GLuint waveListsBuffer = 0;   // two ray lists with their indirect dispatch args
+    GLsizeiptr waveRaysCapacity = 0;
+    GLsizeiptr waveListsCapacity = 0;
+
+    ThreadPool workers;
+    std::unique_ptr<CpuTracer> cpuTracer;
+    std::vector<std::uint8_t> cpuPixels;
+
+    BufferRing cameraUBO;
+    BufferRing diskUBO;
+    // shader storage, any number of objects (GL 4.3 only, like the tracers)
+    BufferRing objectsRing;
+    BufferRing shellsRing;
+    ObjectShells objectShells; // of the objects in objectsRing
+    float uploadedRs = 0.0f;   // the shells were built for
+
+    DeflectionTable deflection;
+    GLuint orbitRadiusTex = 0;
+    GLuint orbitEndTex = 0;
 
     GLuint quadVAO = 0;
+    // flat static mesh, displaced by the masses in gridVert
+    static constexpr float gridExtent = 2.5e11f;
+    int builtGridCells = 0;
+    static constexpr size_t maxGridMasses = 16; // masses[] in gridVert
     GLuint gridVAO = 0, gridVBO = 0, gridEBO = 0;
+    GLuint gridHeightVBO = 0; // only with more than maxGridMasses masses
     int gridIndexCount = 0;
+    std::vector<glm::vec4> gridMasses; // xyz position, w Schwarzschild radius
+    std::vector<float> gridHeights;
 
     float width = 1e11f;
     float height = 7.5e10f;
 
-    static GLuint CreateComputeProgram(const char* src);
-
-    void uploadCameraUBO(const Camera& cam) const;
-    void uploadObjectsUBO(const std::vector<ObjectData>& objs) const;
-    void uploadDiskUBO(const BlackHole& hole) const;
+    // from the program binary cache when possible, compiled from source otherwise
+    static GLuint CreateComputeProgram(const char* src, const ProgramCache& cache);
+    // the geodesicComp permutation for this frame, see the #defines at its top
+    GLuint tracerProgram(bool moving, const BlackHole& hole, size_t objectCount, bool wavefront = false);
+
+    // the deflectionComp permutation for this hole and showDisk
+    GLuint deflectionTracer(const BlackHole& hole);
+    void updateDeflectionTable(float camRadius, float r_s);
+    void allocateTargets();
+    void reproject(const CameraFrame& frame, float focusDistance);
+    void fillHoles(sf::Vector2u offset);
+    void refineEdges(GLuint traceProgram);
+    void traceWavefront(GLuint program, unsigned rays, int steps);
+    void blurImage(); // frames[current] into blurTextures[1]
+
+    [[nodiscard]] glm::vec2 gridVertex(int x, int z) const;
+    static glm::vec4 gridMass(const ObjectData& obj);
+    void buildGridMesh();
 
     void genQuadVAO();
     void genBuffers();
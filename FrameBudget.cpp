@@ -0,0 +1,45 @@
+#include "FrameBudget.h"
+
+#include <algorithm>
+#include <cmath>
+
+FrameBudget::FrameBudget(float startScale)
+    : logScale(std::log(startScale)), applied(startScale) {}
+
+bool FrameBudget::update(std::uint64_t frame, float computeMs) {
+    if (seenFrame && frame <= lastFrame) return false;
+    seenFrame = true;
+    lastFrame = frame;
+    if (settle > 0) {
+        --settle;
+        return false;
+    }
+    if (computeMs <= 0.f) return false;
+
+    const float logMs = std::log(computeMs);
+    logMsFiltered = fresh ? logMs : logMsFiltered + smoothing * (logMs - logMsFiltered);
+    fresh = false;
+    float error = std::clamp(std::log(budgetMs) - logMsFiltered, -1.f, 1.f);
+    if (std::abs(error) < deadband) error = 0.f;
+
+    // velocity form; the pixel count goes with scale^2, so half the log error per axis
+    logScale += 0.5f * (kp * (error - lastError) + ki * error);
+    logScale = std::clamp(logScale, std::log(minScale), std::log(maxScale));
+    lastError = error;
+
+    // only resize towards the budget, never on the way back of the integrator
+    const float target = std::exp(logScale);
+    if (error == 0.f || (target > applied) != (error > 0.f)) return false;
+    const bool atLimit = logScale <= std::log(minScale) || logScale >= std::log(maxScale);
+    if (std::abs(std::log(target / applied)) < std::log(step) && !(atLimit && target != applied)) return false;
+
+    applied = target;
+    settle = settleFrames;
+    fresh = true;
+    return true;
+}
+
+sf::Vector2u FrameBudget::size(sf::Vector2u window) const {
+    return {std::max(1u, (unsigned)std::lround((float)window.x * applied)),
+            std::max(1u, (unsigned)std::lround((float)window.y * applied))};
+}
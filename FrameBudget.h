@@ -0,0 +1,48 @@
+#ifndef BLACKHOLESFML_FRAMEBUDGET_H
+#define BLACKHOLESFML_FRAMEBUDGET_H
+#include <cstdint>
+
+#include <SFML/System/Vector2.hpp>
+
+// Picks the traced resolution so the compute stage stays near budgetMs.
+// Tracing cost is close to proportional to the pixel count, so this is a PI
+// controller on log(budget / measured) driving log(scale): the loop gain is
+// then the same for a cheap and an expensive view. Timings arrive a few frames
+// late (GL queries), hence the low gains and the smoothed input. A resize
+// throws the progressive history away, so the applied scale only moves in
+// steps of `step`, only towards the budget, and the controller ignores the
+// frames still measured at the old size.
+class FrameBudget {
+public:
+    float budgetMs = 10.f;
+    float minScale = 0.125f; // per axis, of the window size
+    float maxScale = 1.f;
+
+    explicit FrameBudget(float startScale = 0.5f);
+
+    // Feed the compute time of a finished frame; repeated frame numbers are ignored.
+    // Returns true when scale() changed and the compute size should follow.
+    bool update(std::uint64_t frame, float computeMs);
+
+    [[nodiscard]] float scale() const { return applied; }
+    [[nodiscard]] sf::Vector2u size(sf::Vector2u window) const;
+
+private:
+    static constexpr float kp = 0.15f;
+    static constexpr float ki = 0.1f;
+    static constexpr float deadband = 0.15f; // |log error| under this counts as on budget, wider than half a step
+    static constexpr float step = 1.1f;      // smallest applied change of the scale
+    static constexpr int settleFrames = 3;   // timing lag after a resize
+    static constexpr float smoothing = 0.3f; // of the measured log time
+
+    float logScale;          // controller output
+    float applied;           // what size() uses
+    float logMsFiltered = 0.f;
+    bool fresh = true;       // no timing at the applied size yet
+    float lastError = 0.f;
+    std::uint64_t lastFrame = 0;
+    bool seenFrame = false;
+    int settle = 0;
+};
+
+#endif //BLACKHOLESFML_FRAMEBUDGET_H
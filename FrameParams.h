@@ -0,0 +1,71 @@
+#ifndef BLACKHOLESFML_FRAMEPARAMS_H
+#define BLACKHOLESFML_FRAMEPARAMS_H
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+// Constants baked into geodesicComp
+constexpr float D_LAMBDA = 1e7f;
+constexpr double ESCAPE_R = 1e30; // DeflectionTable only, the tracers stop at escapeRadius
+
+// Per-frame inputs of the geodesic kernel, shared by the GPU UBOs and the CPU tracer.
+struct CameraFrame {
+    glm::vec3 pos;
+    glm::vec3 right;
+    glm::vec3 up;
+    glm::vec3 forward;
+    float tanHalfFov;
+    float aspect;
+    bool  moving;
+
+    // Camera at pos looking at target with world up +y, fovY in degrees.
+    static CameraFrame lookAt(glm::vec3 pos, glm::vec3 target, float fovY, float aspect, bool moving) {
+        const glm::vec3 fwd = glm::normalize(target - pos);
+        const glm::vec3 right = glm::normalize(glm::cross(fwd, glm::vec3(0, 1, 0)));
+
+        CameraFrame frame{};
+        frame.pos = pos;
+        frame.right = right;
+        frame.up = glm::cross(right, fwd);
+        frame.forward = fwd;
+        frame.tanHalfFov = std::tan(fovY * 0.5f * 3.14159265f / 180.0f);
+        frame.aspect = aspect;
+        frame.moving = moving;
+        return frame;
+    }
+};
+
+struct DiskParams {
+    float r1;
+    float r2;
+    float num;
+    float thickness;
+    float r_s; // of the hole, the CPU tracers bend rays and stop them at the horizon with it
+
+    // The accretion disk every renderer draws: 2.2 to 5.2 Schwarzschild radii.
+    static DiskParams around(double r_s) {
+        DiskParams disk = hidden(r_s);
+        disk.r1 = float(r_s) * 2.2f;
+        disk.r2 = float(r_s) * 5.2f;
+        disk.num = 2.0f;
+        disk.thickness = 1e9f;
+        return disk;
+    }
+
+    // Only the hole, no ray ever lands on the disk.
+    static DiskParams hidden(double r_s) {
+        DiskParams disk{};
+        disk.r_s = float(r_s);
+        return disk;
+    }
+};
+
+// Bounding sphere of everything a ray can hit. Outside it and outside the photon
+// sphere (1.5 r_s) an outgoing ray never turns back, so the tracers stop it there as
+// escaped instead of stepping on towards ESCAPE_R. objectsOuter is ObjectShells::outer.
+inline float escapeRadius(const DiskParams& disk, float objectsOuter) {
+    return std::max({1.5f * disk.r_s, disk.r2, objectsOuter});
+}
+
+#endif //BLACKHOLESFML_FRAMEPARAMS_H
@@ -0,0 +1,170 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+FrameProfiler::Scope::Scope(FrameProfiler& profiler, Stage stage)
+    : profiler(profiler), stage(stage), start(Clock::now()) {
+    if (profiler.frameIndex == 0) return;
+    Pending& frame = profiler.current();
+    if (profiler.timerQueries && !frame.queried[stage]) {
+        glBeginQuery(GL_TIME_ELAPSED, profiler.queries[(profiler.frameIndex - 1) % querySets][stage]);
+        frame.queried[stage] = true;
+        began = true;
+    }
+}
+
+FrameProfiler::Scope::~Scope() {
+    if (profiler.frameIndex == 0) return;
+    const auto end = Clock::now();
+    if (began) glEndQuery(GL_TIME_ELAPSED);
+    Sample& sample = profiler.current().sample;
+    sample.cpuMs[stage] += std::chrono::duration<float, std::milli>(end - start).count();
+    sample.frameMs = std::chrono::duration<float, std::milli>(end - profiler.frameStart).count();
+}
+
+FrameProfiler::~FrameProfiler() {
+    if (timerQueries) glDeleteQueries(querySets * StageCount, &queries[0][0]);
+}
+
+const char* FrameProfiler::stageName(Stage stage) {
+    switch (stage) {
+        case GenerateGrid: return "generate_grid";
+        case DrawGrid: return "draw_grid";
+        case Compute: return "compute";
+        case Blit: return "blit";
+        case Display: return "display";
+        default: return "?";
+    }
+}
+
+void FrameProfiler::beginFrame() {
+    if (frameIndex == 0) {
+        timerQueries = GLEW_ARB_timer_query;
+        if (timerQueries) glGenQueries(querySets * StageCount, &queries[0][0]);
+    }
+
+    // this query set was last used querySets frames ago; take its results only if
+    // they are in, GL_QUERY_RESULT on a pending query would wait for the GPU
+    const unsigned set = frameIndex % querySets;
+    Pending& slot = pending[set];
+    if (slot.active) {
+        bool available = timerQueries;
+        for (int s = 0; s < StageCount && available; ++s) {
+            if (!slot.queried[s]) continue;
+            GLuint ready = GL_FALSE;
+            glGetQueryObjectuiv(queries[set][s], GL_QUERY_RESULT_AVAILABLE, &ready);
+            available = ready == GL_TRUE;
+        }
+        for (int s = 0; s < StageCount && available; ++s) {
+            if (!slot.queried[s]) continue;
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries[set][s], GL_QUERY_RESULT, &ns);
+            slot.sample.gpuMs[s] = (float)((double)ns * 1e-6);
+        }
+        slot.sample.gpuTimed = available;
+        publish(slot.sample);
+    }
+
+    slot = Pending{};
+    slot.active = true;
+    slot.sample.frame = frameIndex++;
+    frameStart = Clock::now();
+}
+
+void FrameProfiler::publish(const Sample& sample) {
+    const std::uint64_t n = written.load(std::memory_order_relaxed);
+    ring[n % capacity] = sample;
+    written.store(n + 1, std::memory_order_release);
+}
+
+bool FrameProfiler::latest(Sample& sample) const {
+    const std::uint64_t end = written.load(std::memory_order_acquire);
+    if (end == 0) return false;
+    sample = ring[(end - 1) % capacity];
+    return true;
+}
+
+std::vector<FrameProfiler::Sample> FrameProfiler::history() const {
+    const std::uint64_t end = written.load(std::memory_order_acquire);
+    const std::uint64_t begin = end > capacity ? end - capacity : 0;
+    std::vector<Sample> samples;
+    samples.reserve(end - begin);
+    for (std::uint64_t i = begin; i < end; ++i)
+        samples.push_back(ring[i % capacity]);
+
+    // drop the slots the writer may have reused while we were copying
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::uint64_t after = written.load(std::memory_order_relaxed);
+    const std::uint64_t firstIntact = after + 1 > capacity ? after + 1 - capacity : 0;
+    if (firstIntact > begin)
+        samples.erase(samples.begin(), samples.begin() + (std::ptrdiff_t)std::min<std::uint64_t>(firstIntact - begin, samples.size()));
+    return samples;
+}
+
+std::string FrameProfiler::summary(std::size_t frames) const {
+    std::vector<Sample> samples = history();
+    if (samples.size() > frames) samples.erase(samples.begin(), samples.end() - (std::ptrdiff_t)frames);
+    if (samples.empty()) return "no frames yet";
+
+    Sample mean;
+    int timed = 0;
+    for (const Sample& s : samples) {
+        mean.frameMs += s.frameMs;
+        timed += s.gpuTimed;
+        for (int i = 0; i < StageCount; ++i) {
+            mean.cpuMs[i] += s.cpuMs[i];
+            mean.gpuMs[i] += s.gpuMs[i];
+        }
+    }
+
+    const float n = (float)samples.size();
+    const float nGpu = (float)std::max(timed, 1);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << "frame " << mean.frameMs / n << " ms";
+    for (int i = 0; i < StageCount; ++i)
+        out << " | " << stageName((Stage)i) << " " << mean.cpuMs[i] / n << "/" << mean.gpuMs[i] / nGpu;
+    return out.str();
+}
+
+bool FrameProfiler::writeCsv(const std::string& path) const {
+    std::ofstream out(path);
+    out << "frame,frame_ms,gpu_timed";
+    for (int i = 0; i < StageCount; ++i)
+        out << "," << stageName((Stage)i) << "_cpu_ms," << stageName((Stage)i) << "_gpu_ms";
+    out << "\n";
+
+    for (const Sample& s : history()) {
+        out << s.frame << "," << s.frameMs << "," << s.gpuTimed;
+        for (int i = 0; i < StageCount; ++i)
+            out << "," << s.cpuMs[i] << "," << s.gpuMs[i];
+        out << "\n";
+    }
+    return (bool)out;
+}
+
+bool FrameProfiler::writeJson(const std::string& path) const {
+    const auto stages = [](std::ostream& out, const std::array<float, StageCount>& ms) {
+        out << "{";
+        for (int i = 0; i < StageCount; ++i)
+            out << (i ? ", " : "") << "\"" << stageName((Stage)i) << "\": " << ms[i];
+        out << "}";
+    };
+
+    std::ofstream out(path);
+    const std::vector<Sample> samples = history();
+    out << "{\"frames\": [\n";
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const Sample& s = samples[i];
+        out << "  {\"frame\": " << s.frame << ", \"frame_ms\": " << s.frameMs
+            << ", \"gpu_timed\": " << (s.gpuTimed ? "true" : "false") << ", \"cpu_ms\": ";
+        stages(out, s.cpuMs);
+        out << ", \"gpu_ms\": ";
+        stages(out, s.gpuMs);
+        out << "}" << (i + 1 < samples.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    return (bool)out;
+}
@@ -0,0 +1,91 @@
+#ifndef BLACKHOLESFML_FRAMEPROFILER_H
+#define BLACKHOLESFML_FRAMEPROFILER_H
+#include <GL/glew.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per-stage frame timings: CPU wall time plus a GL_TIME_ELAPSED query per stage.
+// Queries rotate through querySets sets and frame N is read back at the start of
+// frame N + querySets, only if GL_QUERY_RESULT_AVAILABLE says so; a frame whose
+// results are still out is published without GPU times rather than waited for.
+// Finished frames go into a ring that one thread writes and others may read;
+// readers never block the writer.
+class FrameProfiler {
+public:
+    enum Stage { GenerateGrid, DrawGrid, Compute, Blit, Display, StageCount };
+
+    struct Sample {
+        std::uint64_t frame = 0;
+        float frameMs = 0;                     // beginFrame to the end of the last stage
+        std::array<float, StageCount> cpuMs{}; // 0 for stages that did not run
+        std::array<float, StageCount> gpuMs{}; // 0 as well without timer queries
+        bool gpuTimed = false;                 // gpuMs holds every queried stage's result
+    };
+
+    // Times one stage from construction to destruction.
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, Stage stage);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameProfiler& profiler;
+        Stage stage;
+        bool began = false; // this Scope owns the stage's query of the frame
+        std::chrono::steady_clock::time_point start;
+    };
+
+    FrameProfiler() = default;
+    ~FrameProfiler();
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    static const char* stageName(Stage stage);
+
+    // Needs the GL context current. Call once per drawn frame, before any Scope.
+    void beginFrame();
+
+    // Newest finished frame, false before the first one.
+    bool latest(Sample& sample) const;
+    // Finished frames, oldest first, at most `capacity`.
+    [[nodiscard]] std::vector<Sample> history() const;
+    // "grid 0.10/0.25 ms | ..." with CPU/GPU averages over the last `frames` frames,
+    // GPU ones over the frames among them that have GPU times
+    [[nodiscard]] std::string summary(std::size_t frames = 60) const;
+
+    bool writeCsv(const std::string& path) const;
+    bool writeJson(const std::string& path) const;
+
+    static constexpr std::size_t capacity = 1024;
+    static constexpr unsigned querySets = 3;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        Sample sample;
+        std::array<bool, StageCount> queried{};
+        bool active = false;
+    };
+
+    bool timerQueries = false;
+    GLuint queries[querySets][StageCount]{};
+    Pending pending[querySets];
+    std::uint64_t frameIndex = 0;
+    Clock::time_point frameStart;
+
+    std::array<Sample, capacity> ring;
+    std::atomic<std::uint64_t> written{0};
+
+    Pending& current() { return pending[(frameIndex - 1) % querySets]; }
+    void publish(const Sample& sample);
+};
+
+#endif //BLACKHOLESFML_FRAMEPROFILER_H
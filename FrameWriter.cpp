@@ -0,0 +1,92 @@
+#include "FrameWriter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+#include <SFML/Graphics/Image.hpp>
+
+FrameWriter::FrameWriter(std::string prefix, Format format, std::size_t capacity)
+    : prefix(std::move(prefix)), format(format), capacity(std::max<std::size_t>(capacity, 1)) {
+    thread = std::thread(&FrameWriter::run, this);
+}
+
+FrameWriter::~FrameWriter() {
+    finish();
+}
+
+bool FrameWriter::push(int index, sf::Vector2u size, std::vector<std::uint8_t> rgba) {
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [&] { return queue.size() < capacity || !failure.empty(); });
+    if (!failure.empty()) return false;
+    queue.push_back({index, size, std::move(rgba)});
+    lock.unlock();
+    changed.notify_all();
+    return true;
+}
+
+bool FrameWriter::finish() {
+    {
+        std::lock_guard lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    if (thread.joinable()) thread.join();
+    return error().empty();
+}
+
+std::string FrameWriter::error() {
+    std::lock_guard lock(mutex);
+    return failure.empty() ? failure : "Failed to write " + failure;
+}
+
+void FrameWriter::run() {
+    for (;;) {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return closing || !queue.empty(); });
+        if (queue.empty()) return;
+        const Frame frame = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        changed.notify_all();
+
+        if (std::string path = write(frame); !path.empty()) {
+            lock.lock();
+            failure = std::move(path);
+            queue.clear();
+            lock.unlock();
+            changed.notify_all();
+            return;
+        }
+    }
+}
+
+std::string FrameWriter::write(const Frame& frame) const {
+    static const char* extensions[] = {"raw", "ppm", "png"};
+    char name[32];
+    std::snprintf(name, sizeof(name), "%06d.%s", frame.index, extensions[(int)format]);
+    const std::string path = prefix + name;
+
+    bool ok = false;
+    if (format == Format::Png) {
+        ok = sf::Image(frame.size, frame.rgba.data()).saveToFile(path);
+    } else {
+        std::ofstream out(path, std::ios::binary);
+        if (format == Format::Ppm) {
+            out << "P6\n" << frame.size.x << " " << frame.size.y << "\n255\n";
+            std::vector<char> rgb(frame.rgba.size() / 4 * 3);
+            for (std::size_t i = 0, j = 0; i < frame.rgba.size(); i += 4, j += 3) {
+                rgb[j] = (char)frame.rgba[i];
+                rgb[j + 1] = (char)frame.rgba[i + 1];
+                rgb[j + 2] = (char)frame.rgba[i + 2];
+            }
+            out.write(rgb.data(), (std::streamsize)rgb.size());
+        } else {
+            out.write(reinterpret_cast<const char*>(frame.rgba.data()), (std::streamsize)frame.rgba.size());
+        }
+        ok = (bool)out;
+    }
+
+    return ok ? std::string() : path;
+}
@@ -0,0 +1,54 @@
+#ifndef BLACKHOLESFML_FRAMEWRITER_H
+#define BLACKHOLESFML_FRAMEWRITER_H
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+// Encodes and saves frames on its own thread, so disk I/O overlaps with rendering.
+// push() blocks while `capacity` frames are already waiting; finish() and the
+// destructor drain the queue. Frames go to <prefix><index, 6 digits>.<raw|ppm|png>.
+// The first failed write stops the writer, push() and finish() then return false
+// and error() says which file.
+class FrameWriter {
+public:
+    enum class Format { Raw, Ppm, Png };
+
+    FrameWriter(std::string prefix, Format format, std::size_t capacity);
+    ~FrameWriter();
+
+    // rgba is size.x * size.y RGBA8 pixels, row 0 on top
+    bool push(int index, sf::Vector2u size, std::vector<std::uint8_t> rgba);
+    // Writes what is queued and stops the thread.
+    bool finish();
+    [[nodiscard]] std::string error();
+
+private:
+    struct Frame {
+        int index;
+        sf::Vector2u size;
+        std::vector<std::uint8_t> rgba;
+    };
+
+    std::string prefix;
+    Format format;
+    std::size_t capacity;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Frame> queue;
+    bool closing = false;
+    std::string failure; // empty while every write succeeded
+    std::thread thread;
+
+    void run();
+    // the path that could not be written, empty on success
+    std::string write(const Frame& frame) const;
+};
+
+#endif //BLACKHOLESFML_FRAMEWRITER_H
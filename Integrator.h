@@ -0,0 +1,126 @@
+#ifndef BLACKHOLESFML_INTEGRATOR_H
+#define BLACKHOLESFML_INTEGRATOR_H
+#include <cmath>
+#include <cstddef>
+
+#include "FrameParams.h"
+#include "Simd.h"
+
+// Adaptive Dormand-Prince 5(4) integration of the Schwarzschild null geodesic,
+// written once for T = float (scalar CPU path) and T = simd::vfloat (ray packets).
+// geodesicComp carries the same scheme, coefficient for coefficient.
+namespace geodesic {
+
+template<typename T> T lit(float a);
+template<> inline float lit<float>(float a) { return a; }
+template<> inline simd::vfloat lit<simd::vfloat>(float a) { return simd::set1(a); }
+
+inline void  sincos(float x, float& s, float& c) { s = std::sin(x); c = std::cos(x); }
+inline float abs(float a)                        { return std::fabs(a); }
+inline float sqrt(float a)                       { return std::sqrt(a); }
+inline float min(float a, float b)               { return a < b ? a : b; }
+inline float max(float a, float b)               { return a > b ? a : b; }
+using simd::sincos;
+using simd::abs;
+using simd::sqrt;
+using simd::min;
+using simd::max;
+
+// Step control, as fractions of the current radius
+constexpr float MAX_STEP = 0.1f;
+constexpr float MIN_STEP = 1e-5f;
+
+template<typename T>
+struct State {
+    T r, theta, phi;
+    T dr, dtheta, dphi;
+};
+
+// geodesicRHS, rs is the hole's Schwarzschild radius
+template<typename T>
+State<T> derivative(const State<T>& y, T E, float rs) {
+    const T two = lit<T>(2.0f);
+    T st, ct;
+    sincos(y.theta, st, ct);
+
+    const T f = lit<T>(1.0f) - lit<T>(rs) / y.r;
+    const T dt_dL = E / f;
+    const T k = lit<T>(0.5f * rs) / (y.r * y.r);
+
+    State<T> d;
+    d.r      = y.dr;
+    d.theta  = y.dtheta;
+    d.phi    = y.dphi;
+    d.dr     = -(k * f * dt_dL * dt_dL) + (k / f) * y.dr * y.dr
+             + y.r * (y.dtheta * y.dtheta + st * st * y.dphi * y.dphi);
+    d.dtheta = -two * y.dr * y.dtheta / y.r + st * ct * y.dphi * y.dphi;
+    d.dphi   = -two * y.dr * y.dphi / y.r - two * ct / st * y.dtheta * y.dphi;
+    return d;
+}
+
+// y + h * sum(c[i] * k[i]), zero coefficients skipped
+template<typename T, size_t N>
+State<T> advance(const State<T>& y, T h, const float (&c)[N], const State<T>* k) {
+    State<T> acc{lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f)};
+    for (size_t i = 0; i < N; ++i) {
+        if (c[i] == 0.0f) continue;
+        const T ci = lit<T>(c[i]);
+        acc.r      = acc.r      + ci * k[i].r;
+        acc.theta  = acc.theta  + ci * k[i].theta;
+        acc.phi    = acc.phi    + ci * k[i].phi;
+        acc.dr     = acc.dr     + ci * k[i].dr;
+        acc.dtheta = acc.dtheta + ci * k[i].dtheta;
+        acc.dphi   = acc.dphi   + ci * k[i].dphi;
+    }
+    return {y.r + h * acc.r, y.theta + h * acc.theta, y.phi + h * acc.phi,
+            y.dr + h * acc.dr, y.dtheta + h * acc.dtheta, y.dphi + h * acc.dphi};
+}
+
+// One trial step of length h. Writes the 5th-order solution to out and returns
+// the embedded error estimate, scaled so every component reads as a relative
+// position/direction error (angles and their rates are multiplied back by r).
+template<typename T>
+T dormandPrince(const State<T>& y, T E, float rs, T h, State<T>& out) {
+    static constexpr float a2[] = {1.0f/5.0f};
+    static constexpr float a3[] = {3.0f/40.0f, 9.0f/40.0f};
+    static constexpr float a4[] = {44.0f/45.0f, -56.0f/15.0f, 32.0f/9.0f};
+    static constexpr float a5[] = {19372.0f/6561.0f, -25360.0f/2187.0f, 64448.0f/6561.0f, -212.0f/729.0f};
+    static constexpr float a6[] = {9017.0f/3168.0f, -355.0f/33.0f, 46732.0f/5247.0f, 49.0f/176.0f, -5103.0f/18656.0f};
+    static constexpr float b5[] = {35.0f/384.0f, 0.0f, 500.0f/1113.0f, 125.0f/192.0f, -2187.0f/6784.0f, 11.0f/84.0f};
+    static constexpr float e[]  = {71.0f/57600.0f, 0.0f, -71.0f/16695.0f, 71.0f/1920.0f,
+                                   -17253.0f/339200.0f, 22.0f/525.0f, -1.0f/40.0f};
+
+    State<T> k[7];
+    k[0] = derivative(y, E, rs);
+    k[1] = derivative(advance(y, h, a2, k), E, rs);
+    k[2] = derivative(advance(y, h, a3, k), E, rs);
+    k[3] = derivative(advance(y, h, a4, k), E, rs);
+    k[4] = derivative(advance(y, h, a5, k), E, rs);
+    k[5] = derivative(advance(y, h, a6, k), E, rs);
+    out  = advance(y, h, b5, k);
+    k[6] = derivative(out, E, rs);
+
+    const State<T> zero{lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f), lit<T>(0.0f)};
+    const State<T> err = advance(zero, h, e, k);
+    T norm = max(abs(err.r) / y.r, abs(err.dr));
+    norm = max(norm, max(abs(err.theta), abs(err.phi)));
+    norm = max(norm, max(abs(err.dtheta), abs(err.dphi)) * y.r);
+    return norm;
+}
+
+// Next trial step from the error relative to tolerance (err > 1: rejected). The
+// estimate is of the 4th-order solution, O(h^5), hence err^-1/5, here from square
+// roots as err^-51/256 (no vector pow): within 1% wherever the clamp does not apply.
+template<typename T>
+T nextStep(T h, T err) {
+    const T e4 = sqrt(sqrt(max(err, lit<T>(1e-10f))));
+    const T e16 = sqrt(sqrt(e4));
+    const T e64 = sqrt(sqrt(e16));
+    const T e256 = sqrt(sqrt(e64));
+    const T fac = lit<T>(0.9f) * e16 * e256 / (e4 * e64);
+    return h * min(max(fac, lit<T>(0.2f)), lit<T>(5.0f));
+}
+
+} // namespace geodesic
+
+#endif //BLACKHOLESFML_INTEGRATOR_H
@@ -0,0 +1,36 @@
+#ifndef BLACKHOLESFML_MAILBOX_H
+#define BLACKHOLESFML_MAILBOX_H
+#include <atomic>
+
+// Latest-value handoff from one producer thread to one consumer thread, lock free.
+// There are three slots: the producer fills its back slot and swaps it with the middle
+// one, the consumer swaps the middle one with its front slot when it holds something
+// new. Neither side ever waits; a value the consumer was too slow for is replaced.
+template<typename T>
+class Mailbox {
+public:
+    // producer: fill back(), then publish() it
+    T& back() { return slots[backIndex]; }
+    void publish() { backIndex = middle.exchange(backIndex | fresh, std::memory_order_acq_rel) & indexMask; }
+
+    // consumer
+    [[nodiscard]] bool pending() const { return middle.load(std::memory_order_acquire) & fresh; }
+    // true when something was published since the last fetch, front() is then the newest
+    bool fetch() {
+        if (!pending()) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+    [[nodiscard]] const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr unsigned indexMask = 3;
+    static constexpr unsigned fresh = 4; // middle holds an unread value
+
+    T slots[3]{};
+    std::atomic<unsigned> middle{1};
+    unsigned backIndex = 0;
+    unsigned frontIndex = 2;
+};
+
+#endif //BLACKHOLESFML_MAILBOX_H
@@ -0,0 +1,23 @@
+#ifndef BLACKHOLESFML_MAPPEDFILE_H
+#define BLACKHOLESFML_MAPPEDFILE_H
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file, mmap on POSIX and a file mapping on
+// Windows. data() is null when the file could not be opened or is empty.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const unsigned char* data() const { return bytes; }
+    [[nodiscard]] std::size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    std::size_t length = 0;
+};
+
+#endif //BLACKHOLESFML_MAPPEDFILE_H
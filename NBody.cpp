@@ -0,0 +1,314 @@
+#include "NBody.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Simd.h"
+
+namespace {
+    constexpr double G = 6.67430e-11;
+    constexpr std::size_t chunkSize = 512;
+}
+
+NBody::NBody(const BlackHole& hole, const std::vector<ObjectData>& objects, ThreadPool& pool)
+    : holeX(hole.position.x), holeY(hole.position.y), holeZ(hole.position.z),
+      holeMass(hole.mass), holeRs(hole.r_s), pool(pool) {
+    const std::size_t n = objects.size();
+    for (std::vector<double>* v : {&x, &y, &z, &vx, &vy, &vz, &ax, &ay, &az, &mass})
+        v->resize(n);
+    state.resize(n, Free);
+    next.resize(n, -1);
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const ObjectData& obj = objects[i];
+        x[i] = obj.posRadius.x; y[i] = obj.posRadius.y; z[i] = obj.posRadius.z;
+        vx[i] = obj.velocity.x; vy[i] = obj.velocity.y; vz[i] = obj.velocity.z;
+        mass[i] = obj.mass;
+        const double dx = x[i] - holeX, dy = y[i] - holeY, dz = z[i] - holeZ;
+        if (std::sqrt(dx * dx + dy * dy + dz * dz) <= captureRadius * holeRs) state[i] = Pinned;
+    }
+
+    buildTree();
+    computeForces();
+}
+
+int NBody::advance(double realSeconds) {
+    pending += realSeconds * timeScale;
+    int steps = 0;
+    while (pending >= timeStep && steps < maxStepsPerFrame) {
+        step();
+        pending -= timeStep;
+        ++steps;
+    }
+    pending = std::min(pending, timeStep); // drop what a slow frame could not catch up on
+    return steps;
+}
+
+void NBody::step() {
+    const double dt = timeStep;
+    const double capture2 = captureRadius * holeRs * captureRadius * holeRs;
+    forEachChunk([&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (state[i] != Free) continue;
+            vx[i] += 0.5 * dt * ax[i]; vy[i] += 0.5 * dt * ay[i]; vz[i] += 0.5 * dt * az[i];
+            x[i] += dt * vx[i]; y[i] += dt * vy[i]; z[i] += dt * vz[i];
+
+            const double dx = x[i] - holeX, dy = y[i] - holeY, dz = z[i] - holeZ;
+            if (dx * dx + dy * dy + dz * dz < capture2) {
+                state[i] = Captured;
+                x[i] = holeX; y[i] = holeY; z[i] = holeZ;
+                vx[i] = vy[i] = vz[i] = 0.0;
+            }
+        }
+    });
+
+    buildTree();
+    computeForces();
+
+    forEachChunk([&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (state[i] != Free) continue;
+            vx[i] += 0.5 * dt * ax[i]; vy[i] += 0.5 * dt * ay[i]; vz[i] += 0.5 * dt * az[i];
+        }
+    });
+}
+
+void NBody::writeTo(std::vector<ObjectData>& objects) const {
+    for (std::size_t i = 0; i < std::min(objects.size(), size()); ++i) {
+        ObjectData& obj = objects[i];
+        obj.posRadius.x = (float)x[i]; obj.posRadius.y = (float)y[i]; obj.posRadius.z = (float)z[i];
+        obj.velocity = glm::vec3((float)vx[i], (float)vy[i], (float)vz[i]);
+        if (state[i] == Captured) obj.posRadius.w = 0.0f;
+    }
+}
+
+int NBody::addNode(double cx, double cy, double cz, double half, int depth) {
+    Node node{};
+    node.cx = cx; node.cy = cy; node.cz = cz; node.half = half;
+    std::fill(std::begin(node.child), std::end(node.child), -1);
+    node.first = -1;
+    node.depth = depth;
+    node.leaf = true;
+    nodes.push_back(node);
+    return (int)nodes.size() - 1;
+}
+
+int NBody::childFor(int node, int body) {
+    const Node& parent = nodes[node];
+    const int o = (x[body] >= parent.cx ? 1 : 0) | (y[body] >= parent.cy ? 2 : 0) | (z[body] >= parent.cz ? 4 : 0);
+    if (parent.child[o] < 0) {
+        const double h = 0.5 * parent.half;
+        const int c = addNode(parent.cx + (o & 1 ? h : -h), parent.cy + (o & 2 ? h : -h),
+                              parent.cz + (o & 4 ? h : -h), h, parent.depth + 1);
+        nodes[node].child[o] = c; // addNode may have moved parent
+    }
+    return nodes[node].child[o];
+}
+
+void NBody::buildTree() {
+    nodes.clear();
+    double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL}, hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    for (std::size_t i = 0; i < size(); ++i) {
+        if (state[i] != Free) continue;
+        lo[0] = std::min(lo[0], x[i]); hi[0] = std::max(hi[0], x[i]);
+        lo[1] = std::min(lo[1], y[i]); hi[1] = std::max(hi[1], y[i]);
+        lo[2] = std::min(lo[2], z[i]); hi[2] = std::max(hi[2], z[i]);
+    }
+    if (lo[0] > hi[0]) return; // no free bodies
+
+    const double half = 0.5 * std::max({hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2], 1.0}) * 1.0001;
+    addNode(0.5 * (lo[0] + hi[0]), 0.5 * (lo[1] + hi[1]), 0.5 * (lo[2] + hi[2]), half, 0);
+    for (std::size_t i = 0; i < size(); ++i)
+        if (state[i] == Free) insert((int)i);
+    summarize();
+}
+
+void NBody::insert(int body) {
+    int n = 0;
+    while (!nodes[n].leaf) n = childFor(n, body);
+    addToLeaf(n, body);
+    if (nodes[n].count > leafSize && nodes[n].depth < maxDepth) split(n);
+}
+
+void NBody::addToLeaf(int node, int body) {
+    next[body] = nodes[node].first;
+    nodes[node].first = body;
+    ++nodes[node].count;
+}
+
+void NBody::split(int node) {
+    int body = nodes[node].first;
+    nodes[node].first = -1;
+    nodes[node].count = 0;
+    nodes[node].leaf = false;
+
+    while (body >= 0) {
+        const int following = next[body];
+        addToLeaf(childFor(node, body), body);
+        body = following;
+    }
+
+    for (const int c : nodes[node].child)
+        if (c >= 0 && nodes[c].count > leafSize && nodes[c].depth < maxDepth) split(c);
+}
+
+void NBody::summarize() {
+    // children always come after their parent
+    for (int n = (int)nodes.size() - 1; n >= 0; --n) {
+        Node& node = nodes[n];
+        double m = 0, mx = 0, my = 0, mz = 0;
+        node.bodies = 0;
+        if (node.leaf) {
+            node.bodies = node.count;
+            for (int b = node.first; b >= 0; b = next[b]) {
+                m += mass[b];
+                mx += mass[b] * x[b]; my += mass[b] * y[b]; mz += mass[b] * z[b];
+            }
+        } else {
+            for (const int c : node.child) {
+                if (c < 0) continue;
+                const Node& child = nodes[c];
+                node.bodies += child.bodies;
+                m += child.m;
+                mx += child.m * child.mx; my += child.m * child.my; mz += child.m * child.mz;
+            }
+        }
+        node.m = m;
+        if (m > 0) {
+            node.mx = mx / m; node.my = my / m; node.mz = mz / m;
+        } else {
+            node.mx = node.cx; node.my = node.cy; node.mz = node.cz;
+        }
+    }
+}
+
+void NBody::computeForces() {
+    // groups: the largest subtrees with at most groupSize bodies
+    groups.clear();
+    if (!nodes.empty()) {
+        int stack[8 * maxDepth + 8];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const int n = stack[--top];
+            if (nodes[n].bodies <= groupSize || nodes[n].leaf) {
+                if (nodes[n].bodies > 0) groups.push_back(n);
+                continue;
+            }
+            for (const int c : nodes[n].child)
+                if (c >= 0) stack[top++] = c;
+        }
+    }
+
+    constexpr std::size_t groupsPerTask = 4;
+    const std::size_t tasks = (groups.size() + groupsPerTask - 1) / groupsPerTask;
+    const auto run = [&](std::size_t t) {
+        for (std::size_t k = t * groupsPerTask; k < std::min(groups.size(), (t + 1) * groupsPerTask); ++k)
+            accelerateGroup(groups[k]);
+    };
+    if (tasks <= 1) {
+        if (tasks == 1) run(0);
+    } else {
+        pool.parallelFor(tasks, run);
+    }
+}
+
+void NBody::accelerateGroup(int group) {
+    // One walk for all bodies of the group, opening nodes against the group's bounding
+    // box. The result is a list of point masses, relative to the group centre in float,
+    // which is then applied to simd::width bodies at a time.
+    thread_local std::vector<int> members;
+    thread_local std::vector<float> lx, ly, lz, lgm; // position, G * mass
+    members.clear();
+    lx.clear(); ly.clear(); lz.clear(); lgm.clear();
+    const Node& home = nodes[group];
+
+    int stack[8 * maxDepth + 8];
+    int top = 0;
+    stack[top++] = group;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        for (int b = node.first; b >= 0; b = next[b]) members.push_back(b);
+        for (const int c : node.child)
+            if (c >= 0) stack[top++] = c;
+    }
+
+    double lo[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL}, hi[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    for (const int b : members) {
+        lo[0] = std::min(lo[0], x[b]); hi[0] = std::max(hi[0], x[b]);
+        lo[1] = std::min(lo[1], y[b]); hi[1] = std::max(hi[1], y[b]);
+        lo[2] = std::min(lo[2], z[b]); hi[2] = std::max(hi[2], z[b]);
+    }
+
+    const auto add = [&](double px, double py, double pz, double m) {
+        lx.push_back((float)(px - home.cx));
+        ly.push_back((float)(py - home.cy));
+        lz.push_back((float)(pz - home.cz));
+        lgm.push_back((float)(G * m));
+    };
+    const double theta2 = theta * theta;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (node.m <= 0) continue;
+        if (node.leaf) {
+            // includes the group itself; a body on itself adds nothing thanks to the softening
+            for (int b = node.first; b >= 0; b = next[b]) add(x[b], y[b], z[b], mass[b]);
+            continue;
+        }
+
+        const double dx = std::max({lo[0] - node.mx, 0.0, node.mx - hi[0]});
+        const double dy = std::max({lo[1] - node.my, 0.0, node.my - hi[1]});
+        const double dz = std::max({lo[2] - node.mz, 0.0, node.mz - hi[2]});
+        const double size = 2.0 * node.half;
+        if (size * size < theta2 * (dx * dx + dy * dy + dz * dz)) {
+            add(node.mx, node.my, node.mz, node.m);
+        } else {
+            for (const int c : node.child)
+                if (c >= 0) stack[top++] = c;
+        }
+    }
+
+    const simd::vfloat eps2 = simd::set1((float)std::max(softening * softening, 1.0));
+    for (std::size_t first = 0; first < members.size(); first += simd::width) {
+        const int count = (int)std::min<std::size_t>(simd::width, members.size() - first);
+        alignas(64) float bx[simd::width] = {}, by[simd::width] = {}, bz[simd::width] = {};
+        for (int k = 0; k < count; ++k) {
+            const int b = members[first + k];
+            bx[k] = (float)(x[b] - home.cx);
+            by[k] = (float)(y[b] - home.cy);
+            bz[k] = (float)(z[b] - home.cz);
+        }
+
+        const simd::vfloat px = simd::load(bx), py = simd::load(by), pz = simd::load(bz);
+        simd::vfloat sx = simd::set1(0.0f), sy = sx, sz = sx;
+        for (std::size_t e = 0; e < lgm.size(); ++e) {
+            const simd::vfloat dx = simd::set1(lx[e]) - px, dy = simd::set1(ly[e]) - py, dz = simd::set1(lz[e]) - pz;
+            const simd::vfloat d2 = dx * dx + dy * dy + dz * dz + eps2;
+            const simd::vfloat f = simd::set1(lgm[e]) / (d2 * simd::sqrt(d2));
+            sx = sx + f * dx; sy = sy + f * dy; sz = sz + f * dz;
+        }
+        simd::store(bx, sx); simd::store(by, sy); simd::store(bz, sz);
+
+        for (int k = 0; k < count; ++k) {
+            const int b = members[first + k];
+            // the hole is not in the tree and is not softened, capture keeps it finite
+            const double dx = holeX - x[b], dy = holeY - y[b], dz = holeZ - z[b];
+            const double d2 = dx * dx + dy * dy + dz * dz;
+            const double f = G * holeMass / (d2 * std::sqrt(d2));
+            ax[b] = bx[k] + f * dx; ay[b] = by[k] + f * dy; az[b] = bz[k] + f * dz;
+        }
+    }
+}
+
+void NBody::forEachChunk(const std::function<void(std::size_t, std::size_t)>& fn) {
+    const std::size_t n = size();
+    const std::size_t chunks = (n + chunkSize - 1) / chunkSize;
+    if (chunks <= 1) {
+        fn(0, n);
+        return;
+    }
+    pool.parallelFor(chunks, [&](std::size_t c) {
+        fn(c * chunkSize, std::min(n, (c + 1) * chunkSize));
+    });
+}
@@ -0,0 +1,84 @@
+#ifndef BLACKHOLESFML_NBODY_H
+#define BLACKHOLESFML_NBODY_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "BlackHole.h"
+#include "ObjectData.h"
+#include "ThreadPool.h"
+
+// Newtonian gravity between the scene objects, around a fixed BlackHole.
+// Fixed time step, kick-drift-kick leapfrog, state in double precision SoA arrays.
+// Body-body forces come from a Barnes-Hut octree rebuilt every step. Subtrees of up
+// to groupSize bodies share one tree walk, opened against their bounding box, and
+// the resulting list is applied with simd::vfloat; groups are spread over the pool.
+// The hole's pull is added directly. Bodies that fall within captureRadius
+// Schwarzschild radii are swallowed: they stop moving and get radius 0. An object
+// sitting on the hole (the black sphere Scene::sagittarius() lists) is pinned.
+class NBody {
+public:
+    double timeStep = 60.0;     // simulated seconds per step
+    double timeScale = 3600.0;  // simulated seconds per real second
+    int maxStepsPerFrame = 8;   // the rest of a slow frame's time is dropped
+    double theta = 0.5;         // opening angle of the tree walk
+    double softening = 1e10;    // metres, keeps close encounters finite
+    double captureRadius = 2.0; // in Schwarzschild radii
+
+    NBody(const BlackHole& hole, const std::vector<ObjectData>& objects, ThreadPool& pool);
+
+    // Runs the whole steps that fit in realSeconds * timeScale, keeps the remainder.
+    // Returns the number of steps taken.
+    int advance(double realSeconds);
+    void step();
+    // real time until advance() takes its next step
+    [[nodiscard]] double secondsToNextStep() const { return (timeStep - pending) / timeScale; }
+
+    // positions and velocities back into the objects the simulation was made from
+    void writeTo(std::vector<ObjectData>& objects) const;
+
+    [[nodiscard]] std::size_t size() const { return mass.size(); }
+
+private:
+    static constexpr int leafSize = 8;
+    static constexpr int groupSize = 32;
+    static constexpr int maxDepth = 32;
+
+    enum State : std::uint8_t { Free, Pinned, Captured };
+
+    struct Node {
+        double cx, cy, cz, half;   // cube
+        double mx, my, mz, m;      // centre of mass, total mass
+        int child[8];              // -1 when empty
+        int first, count;          // bodies of a leaf, linked through next
+        int bodies;                // in the whole subtree
+        int depth;
+        bool leaf;
+    };
+
+    double holeX, holeY, holeZ;
+    double holeMass;
+    double holeRs;
+    ThreadPool& pool;
+    double pending = 0.0; // simulated time not yet stepped
+
+    std::vector<double> x, y, z, vx, vy, vz, ax, ay, az, mass;
+    std::vector<State> state;
+
+    std::vector<Node> nodes;
+    std::vector<int> next;   // body -> next body in the same leaf
+    std::vector<int> groups; // subtrees that share one tree walk
+
+    void buildTree();
+    int addNode(double cx, double cy, double cz, double half, int depth);
+    int childFor(int node, int body); // the child of node on body's side, created if missing
+    void insert(int body);
+    void addToLeaf(int node, int body);
+    void split(int node);
+    void summarize();
+    void computeForces();
+    void accelerateGroup(int group);
+    void forEachChunk(const std::function<void(std::size_t, std::size_t)>& fn);
+};
+
+#endif //BLACKHOLESFML_NBODY_H
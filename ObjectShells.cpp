@@ -0,0 +1,47 @@
+#include "ObjectShells.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/geometric.hpp>
+
+#include "FrameParams.h"
+#include "Integrator.h"
+
+void ObjectShells::build(const ObjectData* objs, std::size_t n, float r_s) {
+    base = r_s;
+    invLogGrowth = 1.0f / std::log(growth);
+    objects.clear();
+    outer = outerRadius(objs, n);
+
+    // An object of radius R at distance d from the hole is within one step only for
+    // r in (d - R) / (1 + MAX_STEP) .. (d + R) / (1 - MAX_STEP); a bit of slack
+    // keeps float rounding on the safe side.
+    constexpr float reach = 1.05f * geodesic::MAX_STEP;
+    for (int s = 0; s < shellCount; ++s) {
+        const float lo = s == 0 ? 0.0f : base * std::pow(growth, (float)(s - 1));
+        const float hi = s == shellCount - 1 ? std::numeric_limits<float>::infinity()
+                                             : base * std::pow(growth, (float)s);
+        inner[s] = lo;
+        first[s] = (std::uint32_t)objects.size();
+        for (std::size_t i = 0; i < n; ++i) {
+            const float d = glm::length(glm::vec3(objs[i].posRadius));
+            const float radius = objs[i].posRadius.w;
+            if ((d + radius) / (1.0f - reach) >= lo && (d - radius) / (1.0f + reach) <= hi)
+                objects.push_back((std::uint32_t)i);
+        }
+        count[s] = (std::uint32_t)(objects.size() - first[s]);
+    }
+}
+
+float ObjectShells::outerRadius(const ObjectData* objs, std::size_t n) {
+    float outer = 0.0f;
+    for (std::size_t i = 0; i < n; ++i)
+        outer = std::max(outer, glm::length(glm::vec3(objs[i].posRadius)) + objs[i].posRadius.w);
+    return outer;
+}
+
+// a binary search is cheaper than the log the shaders use
+int ObjectShells::shellOf(float r) const {
+    return (int)(std::upper_bound(inner + 1, inner + shellCount, r) - inner) - 1;
+}
@@ -0,0 +1,36 @@
+#ifndef BLACKHOLESFML_OBJECTSHELLS_H
+#define BLACKHOLESFML_OBJECTSHELLS_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ObjectData.h"
+
+// Broad phase for the per-step object tests. Space around the hole is cut into
+// log-spaced radial shells, and each shell lists the objects a ray inside it could
+// touch or be slowed by within one MAX_STEP (see Integrator.h). Everything else is
+// farther than the step limit already allows, so the tracers only walk the list
+// for the shell of the ray's r. Shell 0 reaches down to r = 0 and the last shell
+// out to infinity.
+class ObjectShells {
+public:
+    static constexpr int shellCount = 64;
+    static constexpr float growth = 1.1f; // outer / inner radius of a shell
+
+    float base = 0.0f;        // inner radius of shell 1, the hole's r_s
+    float outer = 0.0f;       // farthest any object reaches from the hole, see escapeRadius
+    float invLogGrowth = 0.0f;
+    float inner[shellCount] = {}; // inner radius of every shell
+    std::uint32_t first[shellCount] = {};
+    std::uint32_t count[shellCount] = {};
+    std::vector<std::uint32_t> objects; // per shell, ascending object index
+
+    void build(const ObjectData* objs, std::size_t n, float r_s);
+    void build(const std::vector<ObjectData>& objs, float r_s) { build(objs.data(), objs.size(), r_s); }
+
+    [[nodiscard]] int shellOf(float r) const;
+    // outer of n objects, without building the shells
+    static float outerRadius(const ObjectData* objs, std::size_t n);
+};
+
+#endif //BLACKHOLESFML_OBJECTSHELLS_H
@@ -0,0 +1,115 @@
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace {
+    std::uint64_t fnv1a(const std::string& text) {
+        std::uint64_t hash = 1469598103934665603ull;
+        for (const unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string glString(GLenum name) {
+        const auto* s = reinterpret_cast<const char*>(glGetString(name));
+        return s ? s : "";
+    }
+}
+
+ProgramCache::ProgramCache(std::string directory_) : directory(std::move(directory_)) {
+    GLint formats = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        directory.clear();
+        return;
+    }
+    driver = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) directory.clear();
+}
+
+std::string ProgramCache::defaultDirectory() {
+    if (const char* dir = std::getenv("BLACKHOLE_SHADER_CACHE")) return dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/BlackHoleSFML";
+    if (const char* home = std::getenv("HOME"); home && *home)
+        return std::string(home) + "/.cache/BlackHoleSFML";
+    if (const char* local = std::getenv("LOCALAPPDATA"); local && *local)
+        return std::string(local) + "/BlackHoleSFML";
+    return "";
+}
+
+std::string ProgramCache::pathFor(const char* source) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)fnv1a(driver + "\n" + source));
+    return directory + "/" + name;
+}
+
+GLuint ProgramCache::load(const char* source) const {
+    if (!enabled()) return 0;
+
+    const std::string path = pathFor(source);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+    GLenum format = 0;
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    const std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    GLint ok = GL_FALSE;
+    GLuint program = 0;
+    if (!binary.empty()) {
+        program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+        glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    }
+    if (!ok) {
+        if (program) glDeleteProgram(program);
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::store(const char* source, GLuint program) const {
+    if (!enabled()) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<char> binary((size_t)length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    const std::string path = pathFor(source);
+    const std::string temp = path + "." + std::to_string(
+        std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&format), sizeof(format));
+        out.write(binary.data(), (std::streamsize)binary.size());
+        if (!out) {
+            out.close();
+            std::error_code error;
+            std::filesystem::remove(temp, error);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+    if (error) std::filesystem::remove(temp, error);
+}
@@ -0,0 +1,34 @@
+#ifndef BLACKHOLESFML_PROGRAMCACHE_H
+#define BLACKHOLESFML_PROGRAMCACHE_H
+#include <GL/glew.h>
+
+#include <string>
+
+// On-disk cache of linked program binaries (GL 4.1 / ARB_get_program_binary).
+// A file is named after a hash of the shader source and the GL vendor, renderer
+// and version strings, so a driver update simply misses. Binaries the driver
+// rejects are deleted and the caller compiles from source. Files are written
+// to a temporary name and renamed, so concurrent processes can share a directory.
+class ProgramCache {
+public:
+    // Needs the GL context. An empty directory disables the cache.
+    explicit ProgramCache(std::string directory);
+
+    // BLACKHOLE_SHADER_CACHE if set (empty: no cache), else the user cache directory
+    static std::string defaultDirectory();
+
+    // linked program, or 0 when there is no usable binary
+    [[nodiscard]] GLuint load(const char* source) const;
+    // program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void store(const char* source, GLuint program) const;
+
+    [[nodiscard]] bool enabled() const { return !directory.empty(); }
+
+private:
+    std::string directory;
+    std::string driver; // vendor, renderer and version, part of every key
+
+    [[nodiscard]] std::string pathFor(const char* source) const;
+};
+
+#endif //BLACKHOLESFML_PROGRAMCACHE_H
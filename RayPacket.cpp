@@ -0,0 +1,179 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "Integrator.h"
+
+using namespace simd;
+
+namespace {
+    // Objects listed by the shells spanned by the radii of `lanes`, ascending and each
+    // once, so every lane sees at least its own shell's candidates. The shell range
+    // rarely moves between steps, so the last list is kept until it does.
+    struct NearObjects {
+        int first = -1, last = -1;
+        std::vector<std::uint32_t> index;
+
+        void all(std::size_t numObjects) {
+            index.resize(numObjects);
+            std::iota(index.begin(), index.end(), 0u);
+        }
+
+        void update(const ObjectShells& shells, const simd::vfloat& r, simd::vmask lanes) {
+            alignas(64) float radii[simd::width];
+            simd::store(radii, r);
+            float rMin = 0.0f, rMax = 0.0f;
+            for (unsigned m = simd::bits(lanes), lane = 0; m != 0; m >>= 1, ++lane) {
+                if (!(m & 1u)) continue;
+                rMin = rMax == 0.0f ? radii[lane] : std::min(rMin, radii[lane]);
+                rMax = std::max(rMax, radii[lane]);
+            }
+
+            const int s0 = shells.shellOf(rMin), s1 = shells.shellOf(rMax);
+            if (s0 == first && s1 == last) return;
+            first = s0;
+            last = s1;
+
+            index.clear();
+            for (int s = s0; s <= s1; ++s) {
+                const auto list = shells.objects.begin() + shells.first[s];
+                index.insert(index.end(), list, list + shells.count[s]);
+            }
+            if (s1 > s0) {
+                std::sort(index.begin(), index.end());
+                index.erase(std::unique(index.begin(), index.end()), index.end());
+            }
+        }
+    };
+}
+
+void integratePacket(RayPacket& rays, int count, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                     const ObjectShells& shells, int steps, float tolerance) {
+    constexpr int W = RayPacket::width;
+    using State = geodesic::State<vfloat>;
+
+    State y{load(rays.r), load(rays.theta), load(rays.phi), load(rays.dr), load(rays.dtheta), load(rays.dphi)};
+    const vfloat E = load(rays.E);
+
+    vfloat st, ct, sp, cp;
+    sincos(y.theta, st, ct);
+    sincos(y.phi, sp, cp);
+    vfloat x = y.r * st * cp;
+    vfloat py = y.r * st * sp;
+    vfloat z = y.r * ct;
+
+    // per-lane result, kept as floats so it can ride the same blends
+    vfloat hit    = set1((float)HitClass::Escape);
+    vfloat object = set1(-1.0f);
+
+    const vfloat rs      = set1(disk.r_s);
+    const vfloat zero    = set1(0.0f);
+    const vfloat diskR1  = set1(disk.r1 * disk.r1);
+    const vfloat diskR2  = set1(disk.r2 * disk.r2);
+    const vfloat nearR1  = set1(0.25f * disk.r1 * disk.r1);
+    const vfloat nearR2  = set1(4.0f * disk.r2 * disk.r2);
+    const vfloat slab    = set1(disk.thickness);
+    const vfloat escape  = set1(escapeRadius(disk, shells.outer));
+    const vfloat invTol  = set1(1.0f / tolerance);
+    const vfloat maxStep = set1(geodesic::MAX_STEP);
+    const vfloat minStep = set1(geodesic::MIN_STEP);
+    const vfloat one     = set1(1.0f);
+    const vfloat lambdaMax = set1((float)steps * D_LAMBDA);
+
+    // a handful of objects is cheaper to test outright than to look up
+    const bool broadPhase = objs.size() > 8;
+    NearObjects near;
+    near.all(objs.size());
+    vfloat dL = set1(0.01f) * y.r;
+    vfloat lambda = zero;
+    vmask active = firstLanes(std::min(count, W));
+    for (int step = 0; step < steps && any(active); ++step) {
+        const vmask horizon = active & (y.r <= rs);
+        hit = select(horizon, set1((float)HitClass::BlackHole), hit);
+        active = andNot(active, horizon);
+
+        // stepLimit
+        vfloat hMax = maxStep * y.r;
+        if (broadPhase) near.update(shells, y.r, active);
+        for (const std::uint32_t i : near.index) {
+            const glm::vec4& o = objs[i].posRadius;
+            const vfloat ox = x - set1(o.x), oy = py - set1(o.y), oz = z - set1(o.z);
+            const vfloat surface = sqrt(ox * ox + oy * oy + oz * oz) - set1(o.w);
+            hMax = min(hMax, max(surface, set1(0.2f * o.w)));
+        }
+        const vfloat rho2 = x * x + z * z;
+        const vmask overDisk = (rho2 > nearR1) & (rho2 < nearR2);
+        hMax = select(overDisk, min(hMax, max(abs(py), slab)), hMax);
+        const vfloat h = min(dL, hMax);
+
+        // rk45Step, frozen for stopped and rejected lanes
+        State y5;
+        const vfloat err = geodesic::dormandPrince(y, E, disk.r_s, h, y5) * invTol;
+        dL = select(active, geodesic::nextStep(h, err), dL);
+        const vmask accepted = active & ((err <= one) | (h <= minStep * y.r));
+        y.r      = select(accepted, y5.r,      y.r);
+        y.theta  = select(accepted, y5.theta,  y.theta);
+        y.phi    = select(accepted, y5.phi,    y.phi);
+        y.dr     = select(accepted, y5.dr,     y.dr);
+        y.dtheta = select(accepted, y5.dtheta, y.dtheta);
+        y.dphi   = select(accepted, y5.dphi,   y.dphi);
+        lambda   = select(accepted, lambda + h, lambda);
+
+        const vfloat prevX = x, prevY = py, prevZ = z;
+        sincos(y.theta, st, ct);
+        sincos(y.phi, sp, cp);
+        x  = select(accepted, y.r * st * cp, x);
+        py = select(accepted, y.r * st * sp, py);
+        z  = select(accepted, y.r * ct, z);
+
+        // crossesEquatorialPlane, hit point interpolated inside the step
+        const vmask crossed = accepted & (prevY * py < zero);
+        if (any(crossed)) {
+            const vfloat t = prevY / (prevY - py);
+            const vfloat cx = prevX + (x - prevX) * t;
+            const vfloat cz = prevZ + (z - prevZ) * t;
+            const vfloat crossR2 = cx * cx + cz * cz;
+            const vmask onDisk = crossed & (crossR2 >= diskR1) & (crossR2 <= diskR2);
+            hit = select(onDisk, set1((float)HitClass::Disk), hit);
+            x  = select(onDisk, cx, x);
+            py = select(onDisk, zero, py);
+            z  = select(onDisk, cz, z);
+            active = andNot(active, onDisk);
+        }
+
+        // interceptObject, first match wins
+        const vmask moved = active & accepted;
+        vmask inAny = andNot(moved, moved);
+        if (broadPhase && any(moved)) near.update(shells, y.r, moved);
+        for (std::size_t k = 0; any(moved) && k < near.index.size(); ++k) {
+            const std::uint32_t i = near.index[k];
+            const glm::vec4& o = objs[i].posRadius;
+            const vfloat ox = x - set1(o.x), oy = py - set1(o.y), oz = z - set1(o.z);
+            const vmask inside = andNot(moved & (ox * ox + oy * oy + oz * oz <= set1(o.w * o.w)), inAny);
+            object = select(inside, set1((float)i), object); // exact below 2^24 objects
+            inAny = inAny | inside;
+        }
+        hit = select(inAny, set1((float)HitClass::Object), hit);
+        active = andNot(active, inAny);
+
+        active = andNot(active, ((y.r > escape) & (y.dr > zero)) | (lambda >= lambdaMax));
+    }
+
+    alignas(64) float hitOut[W], objectOut[W];
+    store(rays.r, y.r);
+    store(rays.theta, y.theta);
+    store(rays.phi, y.phi);
+    store(rays.dr, y.dr);
+    store(rays.dtheta, y.dtheta);
+    store(rays.dphi, y.dphi);
+    store(rays.x, x);
+    store(rays.y, py);
+    store(rays.z, z);
+    store(hitOut, hit);
+    store(objectOut, object);
+    for (int i = 0; i < W; ++i) {
+        rays.hit[i] = (HitClass)(int)hitOut[i];
+        rays.object[i] = (int)objectOut[i];
+    }
+}
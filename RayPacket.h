@@ -0,0 +1,44 @@
+#ifndef BLACKHOLESFML_RAYPACKET_H
+#define BLACKHOLESFML_RAYPACKET_H
+#include <cstdint>
+#include <vector>
+
+#include "FrameParams.h"
+#include "ObjectData.h"
+#include "ObjectShells.h"
+#include "Simd.h"
+
+enum class HitClass : std::uint8_t { Escape, BlackHole, Disk, Object };
+
+// Structure-of-arrays bundle of simd::width rays, laid out so every field loads
+// straight into one vector register.
+struct RayPacket {
+    static constexpr int width = simd::width;
+
+    // state, filled by the caller
+    alignas(64) float r[width];
+    alignas(64) float theta[width];
+    alignas(64) float phi[width];
+    alignas(64) float dr[width];
+    alignas(64) float dtheta[width];
+    alignas(64) float dphi[width];
+    alignas(64) float E[width];
+    alignas(64) float L[width];
+
+    // where each lane stopped, filled by integratePacket
+    alignas(64) float x[width];
+    alignas(64) float y[width];
+    alignas(64) float z[width];
+    HitClass hit[width];
+    int object[width];
+};
+
+// Runs the geodesicComp loop on the first `count` lanes at once, each lane with
+// its own adaptive step. A lane is masked off as soon as it hits the horizon,
+// the disk or an object, and the packet returns when every lane has stopped or
+// `steps` is used up. For disk hits x/y/z is the interpolated crossing point.
+// Objects are only tested when a lane's shell in `shells` lists them.
+void integratePacket(RayPacket& rays, int count, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                     const ObjectShells& shells, int steps, float tolerance);
+
+#endif //BLACKHOLESFML_RAYPACKET_H
@@ -0,0 +1,149 @@
+#include "Scene.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+#include "MappedFile.h"
+
+namespace {
+    constexpr double G = 6.67430e-11;
+
+    // 64 bytes, followed by objectCount ObjectData records
+    struct BinaryHeader {
+        char magic[4];            // "BHSC"
+        std::uint32_t version;
+        std::uint32_t objectSize; // sizeof(ObjectData)
+        std::uint32_t reserved;
+        std::uint64_t objectCount;
+        double hole[4];           // x, y, z, mass
+        std::uint64_t padding;
+    };
+    constexpr char binaryMagic[4] = {'B', 'H', 'S', 'C'};
+    constexpr std::uint32_t binaryVersion = 1;
+
+    static_assert(sizeof(BinaryHeader) == 64, "scene header layout");
+    static_assert(sizeof(ObjectData) == 48 && std::is_trivially_copyable_v<ObjectData>,
+                  "scene records are ObjectData as is");
+}
+
+Scene Scene::sagittarius() {
+    Scene scene{BlackHole(glm::vec3(0.0f, 0.0f, 0.0f), 8.54e36), {}};
+    const auto orbit = (float)std::sqrt(G * scene.hole.mass / 4e11); // circular
+    scene.objects = {
+        { glm::vec4(4e11f, 0.0f, 0.0f, 4e10f)   , glm::vec4(1,1,0,1), 1.98892e30f, glm::vec3(0.0f, 0.0f, orbit) },
+        { glm::vec4(0.0f, 0.0f, 4e11f, 4e10f)   , glm::vec4(1,0,0,1), 1.98892e30f, glm::vec3(-orbit, 0.0f, 0.0f) },
+        { glm::vec4(0.0f, 0.0f, 0.0f, (float)scene.hole.r_s) , glm::vec4(0,0,0,1), (float)scene.hole.mass },
+    };
+    return scene;
+}
+
+Scene Scene::loadText(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open scene " << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Scene scene{BlackHole(glm::vec3(0.0f), 0.0f), {}};
+    bool hasHole = false;
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind)) continue;
+
+        bool ok = false;
+        if (kind == "hole") {
+            glm::vec3 pos;
+            float mass;
+            ok = (bool)(fields >> pos.x >> pos.y >> pos.z >> mass);
+            if (ok) scene.hole = BlackHole(pos, mass);
+            hasHole = hasHole || ok;
+        } else if (kind == "object") {
+            ObjectData obj{};
+            ok = (bool)(fields >> obj.posRadius.x >> obj.posRadius.y >> obj.posRadius.z >> obj.posRadius.w
+                              >> obj.color.x >> obj.color.y >> obj.color.z >> obj.color.w >> obj.mass);
+            if (ok && !(fields >> obj.velocity.x)) {
+                fields.clear();
+            } else if (ok) {
+                ok = (bool)(fields >> obj.velocity.y >> obj.velocity.z);
+            }
+            if (ok) scene.objects.push_back(obj);
+        }
+        if (!ok) {
+            std::cerr << path << ":" << lineNo << ": bad scene entry: " << line << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!hasHole) {
+        std::cerr << path << ": scene has no hole" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return scene;
+}
+
+Scene Scene::loadBinary(const std::string& path) {
+    const MappedFile file(path);
+    if (!file.data()) {
+        std::cerr << "Failed to open scene " << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    BinaryHeader header{};
+    if (file.size() >= sizeof(header)) std::memcpy(&header, file.data(), sizeof(header));
+    if (file.size() < sizeof(header) || std::memcmp(header.magic, binaryMagic, sizeof(binaryMagic)) != 0) {
+        std::cerr << path << ": not a binary scene" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (header.version != binaryVersion || header.objectSize != sizeof(ObjectData)) {
+        std::cerr << path << ": unsupported scene version " << header.version
+                  << " (record size " << header.objectSize << ")" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const std::size_t records = (file.size() - sizeof(header)) / sizeof(ObjectData);
+    if (header.objectCount != records || (file.size() - sizeof(header)) % sizeof(ObjectData) != 0) {
+        std::cerr << path << ": scene lists " << header.objectCount << " objects but holds "
+                  << records << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Scene scene{BlackHole(glm::vec3((float)header.hole[0], (float)header.hole[1], (float)header.hole[2]),
+                          (float)header.hole[3]), {}};
+    scene.objects.resize(records);
+    if (records > 0)
+        std::memcpy(scene.objects.data(), file.data() + sizeof(header), records * sizeof(ObjectData));
+    return scene;
+}
+
+void Scene::saveBinary(const std::string& path) const {
+    BinaryHeader header{};
+    std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+    header.version = binaryVersion;
+    header.objectSize = sizeof(ObjectData);
+    header.objectCount = objects.size();
+    header.hole[0] = hole.position.x;
+    header.hole[1] = hole.position.y;
+    header.hole[2] = hole.position.z;
+    header.hole[3] = hole.mass;
+
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(objects.data()), (std::streamsize)(objects.size() * sizeof(ObjectData)));
+    if (!out) {
+        std::cerr << "Failed to write scene " << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+Scene Scene::load(const std::string& path) {
+    char magic[sizeof(binaryMagic)] = {};
+    std::ifstream(path, std::ios::binary).read(magic, sizeof(magic));
+    return std::memcmp(magic, binaryMagic, sizeof(magic)) == 0 ? loadBinary(path) : loadText(path);
+}
@@ -0,0 +1,31 @@
+#ifndef BLACKHOLESFML_SCENE_H
+#define BLACKHOLESFML_SCENE_H
+#include <string>
+#include <vector>
+
+#include "BlackHole.h"
+#include "ObjectData.h"
+
+struct Scene {
+    BlackHole hole;
+    std::vector<ObjectData> objects;
+
+    // Sagittarius A with two stars, the interactive default
+    static Scene sagittarius();
+
+    // One entry per line, '#' starts a comment:
+    //   hole   <x> <y> <z> <mass>
+    //   object <x> <y> <z> <radius> <r> <g> <b> <a> <mass> [<vx> <vy> <vz>]
+    // The hole is not drawn by itself; list it as a black object too, like sagittarius() does.
+    static Scene loadText(const std::string& path);
+
+    // Versioned binary form, see Scene.cpp for the header. The file is mapped and the
+    // object records are copied out in one go, they are ObjectData as is (little-endian).
+    static Scene loadBinary(const std::string& path);
+    void saveBinary(const std::string& path) const;
+
+    // binary or text, by the file's first bytes
+    static Scene load(const std::string& path);
+};
+
+#endif //BLACKHOLESFML_SCENE_H
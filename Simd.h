@@ -0,0 +1,176 @@
+#ifndef BLACKHOLESFML_SIMD_H
+#define BLACKHOLESFML_SIMD_H
+#include <cmath>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Thin float-vector wrapper for the ray-packet integrator. The width follows the
+// target: 16 lanes with AVX-512, 8 with AVX2, otherwise 8 plain floats that the
+// compiler vectorizes as well as it can.
+namespace simd {
+
+#if defined(__AVX512F__)
+
+constexpr int width = 16;
+
+struct vfloat { __m512 v; };
+struct vmask  { __mmask16 m; };
+
+inline vfloat set1(float a)           { return {_mm512_set1_ps(a)}; }
+inline vfloat load(const float* p)    { return {_mm512_load_ps(p)}; }
+inline void   store(float* p, vfloat a) { _mm512_store_ps(p, a.v); }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {_mm512_add_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a, vfloat b) { return {_mm512_sub_ps(a.v, b.v)}; }
+inline vfloat operator*(vfloat a, vfloat b) { return {_mm512_mul_ps(a.v, b.v)}; }
+inline vfloat operator/(vfloat a, vfloat b) { return {_mm512_div_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a)           { return {_mm512_sub_ps(_mm512_setzero_ps(), a.v)}; }
+inline vfloat sqrt(vfloat a)                { return {_mm512_sqrt_ps(a.v)}; }
+inline vfloat round(vfloat a)               { return {_mm512_mask_roundscale_ps(a.v, 0xFFFF, a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline vfloat floor(vfloat a)               { return {_mm512_mask_roundscale_ps(a.v, 0xFFFF, a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)}; }
+inline vfloat abs(vfloat a)                 { return {_mm512_abs_ps(a.v)}; }
+inline vfloat min(vfloat a, vfloat b)       { return {_mm512_min_ps(a.v, b.v)}; }
+inline vfloat max(vfloat a, vfloat b)       { return {_mm512_max_ps(a.v, b.v)}; }
+
+inline vmask operator<(vfloat a, vfloat b)  { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)}; }
+inline vmask operator<=(vfloat a, vfloat b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ)}; }
+inline vmask operator>(vfloat a, vfloat b)  { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)}; }
+inline vmask operator>=(vfloat a, vfloat b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ)}; }
+inline vmask operator==(vfloat a, vfloat b) { return {_mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ)}; }
+
+inline vmask operator&(vmask a, vmask b) { return {(__mmask16)(a.m & b.m)}; }
+inline vmask operator|(vmask a, vmask b) { return {(__mmask16)(a.m | b.m)}; }
+inline vmask andNot(vmask a, vmask b)    { return {(__mmask16)(a.m & ~b.m)}; } // a & !b
+inline vmask firstLanes(int n)           { return {(__mmask16)((1u << n) - 1u)}; }
+inline unsigned bits(vmask a)            { return a.m; }
+
+// m ? a : b per lane
+inline vfloat select(vmask m, vfloat a, vfloat b) { return {_mm512_mask_blend_ps(m.m, b.v, a.v)}; }
+
+#elif defined(__AVX2__)
+
+constexpr int width = 8;
+
+struct vfloat { __m256 v; };
+struct vmask  { __m256 m; };
+
+inline vfloat set1(float a)           { return {_mm256_set1_ps(a)}; }
+inline vfloat load(const float* p)    { return {_mm256_load_ps(p)}; }
+inline void   store(float* p, vfloat a) { _mm256_store_ps(p, a.v); }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a, vfloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline vfloat operator*(vfloat a, vfloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline vfloat operator/(vfloat a, vfloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a)           { return {_mm256_sub_ps(_mm256_setzero_ps(), a.v)}; }
+inline vfloat sqrt(vfloat a)                { return {_mm256_sqrt_ps(a.v)}; }
+inline vfloat round(vfloat a)               { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline vfloat floor(vfloat a)               { return {_mm256_floor_ps(a.v)}; }
+inline vfloat abs(vfloat a)                 { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline vfloat min(vfloat a, vfloat b)       { return {_mm256_min_ps(a.v, b.v)}; }
+inline vfloat max(vfloat a, vfloat b)       { return {_mm256_max_ps(a.v, b.v)}; }
+
+inline vmask operator<(vfloat a, vfloat b)  { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline vmask operator<=(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+inline vmask operator>(vfloat a, vfloat b)  { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline vmask operator>=(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+inline vmask operator==(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+
+inline vmask operator&(vmask a, vmask b) { return {_mm256_and_ps(a.m, b.m)}; }
+inline vmask operator|(vmask a, vmask b) { return {_mm256_or_ps(a.m, b.m)}; }
+inline vmask andNot(vmask a, vmask b)    { return {_mm256_andnot_ps(b.m, a.m)}; } // a & !b
+inline unsigned bits(vmask a)            { return (unsigned)_mm256_movemask_ps(a.m); }
+inline vmask firstLanes(int n) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return {_mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(n), lane))};
+}
+
+// m ? a : b per lane
+inline vfloat select(vmask m, vfloat a, vfloat b) { return {_mm256_blendv_ps(b.v, a.v, m.m)}; }
+
+#else
+
+constexpr int width = 8;
+
+struct vfloat { float v[width]; };
+struct vmask  { bool m[width]; };
+
+#define SIMD_LANEWISE(expr) for (int i = 0; i < width; ++i) { expr; }
+
+inline vfloat set1(float a)           { vfloat r; SIMD_LANEWISE(r.v[i] = a) return r; }
+inline vfloat load(const float* p)    { vfloat r; SIMD_LANEWISE(r.v[i] = p[i]) return r; }
+inline void   store(float* p, vfloat a) { SIMD_LANEWISE(p[i] = a.v[i]) }
+
+inline vfloat operator+(vfloat a, vfloat b) { SIMD_LANEWISE(a.v[i] += b.v[i]) return a; }
+inline vfloat operator-(vfloat a, vfloat b) { SIMD_LANEWISE(a.v[i] -= b.v[i]) return a; }
+inline vfloat operator*(vfloat a, vfloat b) { SIMD_LANEWISE(a.v[i] *= b.v[i]) return a; }
+inline vfloat operator/(vfloat a, vfloat b) { SIMD_LANEWISE(a.v[i] /= b.v[i]) return a; }
+inline vfloat operator-(vfloat a)           { SIMD_LANEWISE(a.v[i] = -a.v[i]) return a; }
+inline vfloat sqrt(vfloat a)                { SIMD_LANEWISE(a.v[i] = std::sqrt(a.v[i])) return a; }
+inline vfloat round(vfloat a)               { SIMD_LANEWISE(a.v[i] = std::nearbyint(a.v[i])) return a; }
+inline vfloat floor(vfloat a)               { SIMD_LANEWISE(a.v[i] = std::floor(a.v[i])) return a; }
+inline vfloat abs(vfloat a)                 { SIMD_LANEWISE(a.v[i] = std::fabs(a.v[i])) return a; }
+inline vfloat min(vfloat a, vfloat b)       { SIMD_LANEWISE(a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]) return a; }
+inline vfloat max(vfloat a, vfloat b)       { SIMD_LANEWISE(a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]) return a; }
+
+inline vmask operator<(vfloat a, vfloat b)  { vmask r; SIMD_LANEWISE(r.m[i] = a.v[i] <  b.v[i]) return r; }
+inline vmask operator<=(vfloat a, vfloat b) { vmask r; SIMD_LANEWISE(r.m[i] = a.v[i] <= b.v[i]) return r; }
+inline vmask operator>(vfloat a, vfloat b)  { vmask r; SIMD_LANEWISE(r.m[i] = a.v[i] >  b.v[i]) return r; }
+inline vmask operator>=(vfloat a, vfloat b) { vmask r; SIMD_LANEWISE(r.m[i] = a.v[i] >= b.v[i]) return r; }
+inline vmask operator==(vfloat a, vfloat b) { vmask r; SIMD_LANEWISE(r.m[i] = a.v[i] == b.v[i]) return r; }
+
+inline vmask operator&(vmask a, vmask b) { SIMD_LANEWISE(a.m[i] = a.m[i] && b.m[i]) return a; }
+inline vmask operator|(vmask a, vmask b) { SIMD_LANEWISE(a.m[i] = a.m[i] || b.m[i]) return a; }
+inline vmask andNot(vmask a, vmask b)    { SIMD_LANEWISE(a.m[i] = a.m[i] && !b.m[i]) return a; } // a & !b
+inline vmask firstLanes(int n)           { vmask r; SIMD_LANEWISE(r.m[i] = i < n) return r; }
+inline unsigned bits(vmask a)            { unsigned r = 0; SIMD_LANEWISE(r |= (unsigned)a.m[i] << i) return r; }
+
+// m ? a : b per lane
+inline vfloat select(vmask m, vfloat a, vfloat b) { SIMD_LANEWISE(b.v[i] = m.m[i] ? a.v[i] : b.v[i]) return b; }
+
+#undef SIMD_LANEWISE
+
+#endif
+
+inline bool any(vmask a) { return bits(a) != 0; }
+
+inline vfloat& operator+=(vfloat& a, vfloat b) { return a = a + b; }
+inline vfloat& operator-=(vfloat& a, vfloat b) { return a = a - b; }
+inline vfloat& operator*=(vfloat& a, vfloat b) { return a = a * b; }
+
+// Cephes-style sinf/cosf: Cody-Waite reduction by pi/2, minimax polynomials on
+// [-pi/4, pi/4]. Good to a couple of ulp for the angles a ray accumulates.
+inline void sincos(vfloat x, vfloat& s, vfloat& c) {
+    const vfloat j = round(x * set1(0.63661977236758134f)); // x * 2/pi
+    vfloat y = x - j * set1(1.5703125f);
+    y = y - j * set1(4.837512969970703125e-4f);
+    y = y - j * set1(7.54978995489188216e-8f);
+    const vfloat z = y * y;
+
+    vfloat ps = set1(-1.9515295891e-4f);
+    ps = ps * z + set1(8.3321608736e-3f);
+    ps = ps * z + set1(-1.6666654611e-1f);
+    ps = ps * z * y + y;
+
+    vfloat pc = set1(2.443315711809948e-5f);
+    pc = pc * z + set1(-1.388731625493765e-3f);
+    pc = pc * z + set1(4.166664568298827e-2f);
+    pc = pc * z * z - set1(0.5f) * z + set1(1.0f);
+
+    // quadrant = j mod 4
+    const vfloat q = j - set1(4.0f) * floor(j * set1(0.25f));
+    const vmask swap = (q == set1(1.0f)) | (q == set1(3.0f));
+    const vmask negS = q >= set1(2.0f);
+    const vmask negC = (q == set1(1.0f)) | (q == set1(2.0f));
+
+    s = select(swap, pc, ps);
+    c = select(swap, ps, pc);
+    s = select(negS, -s, s);
+    c = select(negC, -c, c);
+}
+
+} // namespace simd
+
+#endif //BLACKHOLESFML_SIMD_H
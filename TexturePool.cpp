@@ -0,0 +1,60 @@
+#include "TexturePool.h"
+
+#include <algorithm>
+
+sf::Vector2u TexturePool::storageSize(sf::Vector2u size) {
+    const auto roundUp = [](unsigned n) { return std::max(1u, (n + bucket - 1) / bucket) * bucket; };
+    return {roundUp(size.x), roundUp(size.y)};
+}
+
+GLuint TexturePool::acquire(sf::Vector2u size, GLenum format) {
+    size = storageSize(size);
+    const auto match = std::find_if(idle.rbegin(), idle.rend(), [&](const Entry& e) {
+        return e.size == size && e.format == format;
+    });
+    if (match != idle.rend()) {
+        inUse.push_back(*match);
+        idle.erase(std::next(match).base());
+        return inUse.back().texture;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    const GLint filter = format == GL_RGBA8 ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, (GLsizei)size.x, (GLsizei)size.y);
+    } else {
+        const bool integer = format != GL_RGBA8;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, (GLint)format, (GLsizei)size.x, (GLsizei)size.y, 0,
+                     integer ? GL_RED_INTEGER : GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    inUse.push_back({texture, size, format});
+    return texture;
+}
+
+void TexturePool::release(GLuint texture) {
+    const auto it = std::find_if(inUse.begin(), inUse.end(), [&](const Entry& e) { return e.texture == texture; });
+    if (it == inUse.end()) return;
+
+    idle.push_back(*it);
+    inUse.erase(it);
+    if (idle.size() > maxIdle) {
+        glDeleteTextures(1, &idle.front().texture);
+        idle.erase(idle.begin());
+    }
+}
+
+void TexturePool::clear() {
+    for (const std::vector<Entry>* list : {&inUse, &idle})
+        for (const Entry& e : *list)
+            glDeleteTextures(1, &e.texture);
+    inUse.clear();
+    idle.clear();
+}
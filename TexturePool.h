@@ -0,0 +1,38 @@
+#ifndef BLACKHOLESFML_TEXTUREPOOL_H
+#define BLACKHOLESFML_TEXTUREPOOL_H
+#include <GL/glew.h>
+
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+// Render targets in size buckets. A request rounds up to whole buckets and gets
+// an immutable texture (glTexStorage2D where available) of that size; the caller
+// uses the part from texel (0, 0) on. Small resolution changes therefore keep
+// their textures, and released ones are kept for a while in case the size comes
+// back. Needs the GL context for everything, including clear().
+class TexturePool {
+public:
+    static constexpr unsigned bucket = 128; // texels per side
+
+    static sf::Vector2u storageSize(sf::Vector2u size);
+
+    // GL_RGBA8 is filtered linearly, integer formats use nearest
+    GLuint acquire(sf::Vector2u size, GLenum format);
+    void release(GLuint texture); // 0 is ignored
+    void clear();                 // deletes everything, released or not
+
+private:
+    struct Entry {
+        GLuint texture;
+        sf::Vector2u size;
+        GLenum format;
+    };
+
+    static constexpr std::size_t maxIdle = 6;
+
+    std::vector<Entry> inUse;
+    std::vector<Entry> idle; // oldest first
+};
+
+#endif //BLACKHOLESFML_TEXTUREPOOL_H
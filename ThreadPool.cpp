@@ -0,0 +1,91 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < threadCount; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 1; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    std::lock_guard submit(submitMutex);
+
+    job.store(&fn);
+    remaining.store(count);
+    for (size_t i = 0; i < count; ++i) {
+        Queue& q = *queues[i % queues.size()];
+        std::lock_guard lock(q.mutex);
+        q.items.push_back(i);
+    }
+    {
+        std::lock_guard lock(mutex);
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(0);
+
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return remaining.load() == 0; });
+    job.store(nullptr);
+}
+
+bool ThreadPool::popOrSteal(unsigned self, size_t& item) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard lock(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.back();
+            own.items.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(self + k) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.front();
+            victim.items.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::drain(unsigned self) {
+    size_t item;
+    while (popOrSteal(self, item)) {
+        (*job.load())(item);
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        drain(self);
+    }
+}
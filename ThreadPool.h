@@ -0,0 +1,54 @@
+#ifndef BLACKHOLESFML_THREADPOOL_H
+#define BLACKHOLESFML_THREADPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers with one deque each. A parallelFor batch is dealt out
+// round-robin, every worker drains its own deque from the back and steals
+// from the front of the others once it runs dry.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount = 0); // 0 -> hardware_concurrency
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] unsigned size() const { return (unsigned)queues.size(); }
+
+    // Calls fn(i) for every i in [0, count) and blocks until all are done.
+    // The calling thread takes part. Must not be called from inside fn.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // [0] belongs to the calling thread
+    std::vector<std::thread> workers;
+
+    std::mutex submitMutex; // one batch at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    std::atomic<const std::function<void(size_t)>*> job{nullptr};
+    std::atomic<size_t> remaining{0};
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    bool popOrSteal(unsigned self, size_t& item);
+    void drain(unsigned self);
+    void workerLoop(unsigned self);
+};
+
+#endif //BLACKHOLESFML_THREADPOOL_H
@@ -0,0 +1,103 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+
+void TileScheduler::layout(sf::Vector2u grid_) {
+    if (grid_ == grid) return;
+    grid = grid_;
+    ++generation;
+
+    order.clear();
+    for (unsigned y = 0; y < grid.y; y += tileSize)
+        for (unsigned x = 0; x < grid.x; x += tileSize)
+            order.emplace_back(x, y);
+    const auto distance = [&](sf::Vector2u origin) {
+        const float dx = (float)origin.x + tileSize / 2.f - (float)grid.x / 2.f;
+        const float dy = (float)origin.y + tileSize / 2.f - (float)grid.y / 2.f;
+        return dx * dx + dy * dy;
+    };
+    std::stable_sort(order.begin(), order.end(), [&](sf::Vector2u a, sf::Vector2u b) {
+        return distance(a) < distance(b);
+    });
+    costMs.assign(order.size(), -1.f);
+    cursor = 0;
+}
+
+void TileScheduler::run(float budgetMs, const std::function<void(sf::Vector2u, sf::Vector2u)>& dispatch) {
+    if (finished()) return;
+    if (timerQueries < 0) timerQueries = GLEW_ARB_timer_query ? 1 : 0;
+    collect();
+
+    float known = 0.f;
+    int knownCount = 0;
+    for (const float cost : costMs) {
+        if (cost < 0.f) continue;
+        known += cost;
+        ++knownCount;
+    }
+    // before any measurement: a few tiles, the next frames know better
+    const float mean = knownCount > 0 ? known / (float)knownCount : budgetMs / 8.f;
+    const auto predicted = [&](std::size_t k) { return costMs[k] < 0.f ? mean : costMs[k]; };
+
+    const bool sliced = timerQueries && budgetMs > 0.f;
+    std::size_t last = cursor + 1;
+    float total = predicted(cursor);
+    if (!sliced) last = order.size();
+    while (last < order.size() && total + predicted(last) <= budgetMs) total += predicted(last++);
+
+    const bool measure = timerQueries && pending.size() < maxPending;
+    Batch batch{generation, {}, {}};
+    if (measure) batch.stamps.push_back(stamp());
+    for (std::size_t k = cursor; k < last; ++k) {
+        const sf::Vector2u origin = order[k];
+        dispatch(origin, {std::min(tileSize, grid.x - origin.x), std::min(tileSize, grid.y - origin.y)});
+        if (measure) {
+            batch.tiles.push_back((unsigned)k);
+            batch.stamps.push_back(stamp());
+        }
+    }
+    cursor = last;
+    if (measure) pending.push_back(std::move(batch));
+}
+
+void TileScheduler::collect() {
+    while (!pending.empty()) {
+        Batch& batch = pending.front();
+        GLint ready = GL_FALSE;
+        glGetQueryObjectiv(batch.stamps.back(), GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) break;
+
+        if (batch.generation == generation) {
+            GLuint64 previous = 0;
+            glGetQueryObjectui64v(batch.stamps[0], GL_QUERY_RESULT, &previous);
+            for (std::size_t i = 0; i < batch.tiles.size(); ++i) {
+                GLuint64 now = 0;
+                glGetQueryObjectui64v(batch.stamps[i + 1], GL_QUERY_RESULT, &now);
+                costMs[batch.tiles[i]] = (float)((double)(now - previous) * 1e-6);
+                previous = now;
+            }
+        }
+        freeQueries.insert(freeQueries.end(), batch.stamps.begin(), batch.stamps.end());
+        pending.pop_front();
+    }
+}
+
+GLuint TileScheduler::stamp() {
+    GLuint query = 0;
+    if (freeQueries.empty()) {
+        glGenQueries(1, &query);
+    } else {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    }
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+}
+
+void TileScheduler::destroy() {
+    for (const Batch& batch : pending)
+        freeQueries.insert(freeQueries.end(), batch.stamps.begin(), batch.stamps.end());
+    pending.clear();
+    if (!freeQueries.empty()) glDeleteQueries((GLsizei)freeQueries.size(), freeQueries.data());
+    freeQueries.clear();
+}
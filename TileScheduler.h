@@ -0,0 +1,54 @@
+#ifndef BLACKHOLESFML_TILESCHEDULER_H
+#define BLACKHOLESFML_TILESCHEDULER_H
+#include <GL/glew.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <SFML/System/Vector2.hpp>
+
+// Splits one trace pass into tiles and hands out as many per frame as fit a GPU
+// time budget, centre first, so a slow pass spreads over several frames instead
+// of stalling the event loop (or the driver watchdog). The cost of a tile is
+// predicted from its last GL_TIMESTAMP measurement, read back without waiting;
+// tiles not measured yet are assumed to cost the mean. Timestamps rather than
+// GL_TIME_ELAPSED, which is taken by FrameProfiler around the whole stage.
+class TileScheduler {
+public:
+    static constexpr unsigned tileSize = 32; // sampled pixels per side
+
+    // grid: sampled pixels of one pass. A new size drops the order and the costs.
+    void layout(sf::Vector2u grid);
+    void restart() { cursor = 0; }
+    [[nodiscard]] bool started() const { return cursor > 0; }
+    [[nodiscard]] bool finished() const { return cursor >= order.size(); }
+
+    // Calls dispatch for the next tiles whose predicted cost fits budgetMs, at least
+    // one. Without timer queries or with budgetMs <= 0 the rest of the pass goes at once.
+    void run(float budgetMs, const std::function<void(sf::Vector2u origin, sf::Vector2u size)>& dispatch);
+    void destroy();
+
+private:
+    struct Batch {
+        unsigned generation;        // of the layout the tiles belong to
+        std::vector<unsigned> tiles;
+        std::vector<GLuint> stamps; // before the first tile and after every one
+    };
+
+    static constexpr std::size_t maxPending = 8;
+
+    sf::Vector2u grid{0, 0};
+    unsigned generation = 0;
+    std::vector<sf::Vector2u> order; // tile origins, centre first
+    std::vector<float> costMs;       // last measured per tile of order, < 0 unknown
+    std::size_t cursor = 0;
+    std::deque<Batch> pending;
+    std::vector<GLuint> freeQueries;
+    int timerQueries = -1; // not checked yet
+
+    void collect();
+    GLuint stamp();
+};
+
+#endif //BLACKHOLESFML_TILESCHEDULER_H
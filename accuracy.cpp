@@ -0,0 +1,379 @@
+// Accuracy against cost of the tracers, see the `accuracy` target in CMakeLists.txt.
+//   BlackHoleAccuracy [--out <file>] [--reps <n>] [--size <w>x<h>] [--scene <file>] [--cpu-only]
+// Every candidate (tracer, kernel, tolerance, step budget, resolution) renders fixed
+// views and is scored against a double-precision reference: the share of pixels with
+// the reference's hit class, the mean colour error, and the median time. Candidates no
+// other one beats on all three form the Pareto front, the set to pick presets from.
+
+// ---- OpenGL loader first
+#include <GL/glew.h>
+
+// ---- STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include "Camera.h"
+#include "CpuTracer.h"
+#include "Engine.h"
+#include "FrameParams.h"
+#include "Scene.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // median wall time of fn over reps runs, seconds
+    template<typename Fn>
+    double median(int reps, Fn&& fn) {
+        std::vector<double> times;
+        for (int i = 0; i < reps; ++i) {
+            const auto t0 = Clock::now();
+            fn();
+            times.push_back(std::chrono::duration<double>(Clock::now() - t0).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    struct View {
+        const char* name;
+        float radius, elevation, azimuth;
+    };
+
+    // the BlackHoleBench views
+    constexpr View views[] = {
+        {"edge-on", 6.34194e10f, 1.50f, 0.4f},
+        {"above",   6.34194e10f, 0.60f, 0.4f},
+        {"far",     3.0e11f,     1.30f, 1.0f},
+    };
+
+    // ---- reference
+
+    // Same scene tests and shading as geodesicComp, but in double precision, with small
+    // steps and no step budget. The ray follows x'' = -1.5 r_s h^2 x / r^5 (h = |x cross x'|),
+    // which traces the same spatial path as the geodesic without the pole of the
+    // spherical coordinates. Outward bound past everything and the photon sphere, a ray
+    // can no longer turn back, so that is where it escapes.
+    constexpr double referenceTolerance = 1e-11;
+    constexpr double referenceMaxStep = 0.01; // of r
+    constexpr int referenceSteps = 10000000;
+
+    struct Photon {
+        glm::dvec3 x, v;
+    };
+
+    glm::dvec3 acceleration(const glm::dvec3& x, double k) {
+        const double r2 = glm::dot(x, x);
+        return -k * x / (r2 * r2 * std::sqrt(r2));
+    }
+
+    // Dormand-Prince 5(4) step of length h into out, returns the error estimate
+    // relative to position and speed
+    double dormandPrince(const Photon& y, double k, double h, Photon& out) {
+        static constexpr double a[6][6] = {
+            {1.0/5.0},
+            {3.0/40.0, 9.0/40.0},
+            {44.0/45.0, -56.0/15.0, 32.0/9.0},
+            {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0},
+            {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0},
+            {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0},
+        };
+        static constexpr double e[7] = {71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0,
+                                        -17253.0/339200.0, 22.0/525.0, -1.0/40.0};
+        glm::dvec3 kx[7], kv[7];
+        kx[0] = y.v;
+        kv[0] = acceleration(y.x, k);
+        for (int s = 1; s < 7; ++s) {
+            Photon t = y;
+            for (int j = 0; j < s; ++j) {
+                t.x += h * a[s - 1][j] * kx[j];
+                t.v += h * a[s - 1][j] * kv[j];
+            }
+            kx[s] = t.v;
+            kv[s] = acceleration(t.x, k);
+            if (s == 6) out = t; // the last stage is the 5th order solution
+        }
+
+        glm::dvec3 ex(0.0), ev(0.0);
+        for (int j = 0; j < 7; ++j) {
+            ex += h * e[j] * kx[j];
+            ev += h * e[j] * kv[j];
+        }
+        return std::max(glm::length(ex) / glm::length(y.x), glm::length(ev) / glm::length(y.v));
+    }
+
+    glm::vec4 referencePixel(const CameraFrame& cam, const DiskParams& disk, const std::vector<ObjectData>& objs,
+                             double rs, double farRadius, sf::Vector2u size, unsigned px, unsigned py) {
+        const double u = (2.0 * ((double)px + 0.5) / size.x - 1.0) * cam.aspect * cam.tanHalfFov;
+        const double v = (1.0 - 2.0 * ((double)py + 0.5) / size.y) * cam.tanHalfFov;
+        Photon p{glm::dvec3(cam.pos),
+                 glm::normalize(u * glm::dvec3(cam.right) - v * glm::dvec3(cam.up) + glm::dvec3(cam.forward))};
+        const glm::dvec3 h = glm::cross(p.x, p.v);
+        const double k = 1.5 * rs * glm::dot(h, h);
+
+        HitClass hit = HitClass::Escape;
+        glm::dvec3 P = p.x;
+        int object = -1;
+        double dL = 1e-3 * glm::length(p.x);
+        for (int i = 0; i < referenceSteps && hit == HitClass::Escape; ++i) {
+            const double r = glm::length(p.x);
+            if (r <= rs) { hit = HitClass::BlackHole; break; }
+            if (r > farRadius && glm::dot(p.x, p.v) > 0.0) break;
+
+            // like stepLimit, but never deeper into an object than a twentieth of its radius
+            double reach = referenceMaxStep * r;
+            for (const ObjectData& obj : objs) {
+                const double radius = obj.posRadius.w;
+                reach = std::min(reach, std::max(glm::distance(p.x, glm::dvec3(obj.posRadius)) - radius, 0.05 * radius));
+            }
+            const double step = std::min(dL, reach / glm::length(p.v));
+            Photon next;
+            const double err = dormandPrince(p, k, step, next) / referenceTolerance;
+            dL = step * std::clamp(0.9 / std::pow(std::max(err, 1e-10), 0.2), 0.2, 5.0);
+            if (err > 1.0) continue;
+
+            if (p.x.y * next.x.y < 0.0) {
+                const glm::dvec3 c = p.x + (next.x - p.x) * (p.x.y / (p.x.y - next.x.y));
+                const double rho = std::sqrt(c.x * c.x + c.z * c.z);
+                if (rho >= disk.r1 && rho <= disk.r2) { hit = HitClass::Disk; P = c; break; }
+            }
+            p = next;
+            P = p.x;
+            for (size_t o = 0; o < objs.size() && hit == HitClass::Escape; ++o) {
+                if (glm::distance(p.x, glm::dvec3(objs[o].posRadius)) <= objs[o].posRadius.w) {
+                    hit = HitClass::Object;
+                    object = (int)o;
+                }
+            }
+        }
+        return CpuTracer::shade(cam, disk, objs, hit, glm::vec3(P), object);
+    }
+
+    std::uint8_t toUnorm8(float v) {
+        return (std::uint8_t)std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f);
+    }
+
+    void renderReference(ThreadPool& pool, const CameraFrame& cam, const Scene& scene, sf::Vector2u size,
+                         std::vector<std::uint8_t>& rgba) {
+        const DiskParams disk = DiskParams::around(scene.hole.r_s);
+        double farRadius = std::max({(double)glm::length(cam.pos), (double)disk.r2, 1.5 * scene.hole.r_s});
+        for (const ObjectData& obj : scene.objects)
+            farRadius = std::max(farRadius, (double)glm::length(glm::vec3(obj.posRadius)) + obj.posRadius.w);
+        farRadius *= 1.01;
+
+        rgba.resize((size_t)size.x * size.y * 4);
+        pool.parallelFor(size.y, [&](size_t y) {
+            for (unsigned x = 0; x < size.x; ++x) {
+                const glm::vec4 c = referencePixel(cam, disk, scene.objects, scene.hole.r_s, farRadius,
+                                                   size, x, (unsigned)y);
+                std::uint8_t* texel = &rgba[(y * size.x + x) * 4];
+                texel[0] = toUnorm8(c.x); texel[1] = toUnorm8(c.y);
+                texel[2] = toUnorm8(c.z); texel[3] = toUnorm8(c.w);
+            }
+        });
+    }
+
+    // ---- candidates
+
+    struct Candidate {
+        const char* tracer; // cpu, gpu
+        const char* kernel; // rk45, adaptive, planar, table
+        float tolerance;
+        int steps;          // budget of a still frame
+        unsigned divisor;   // of the reference resolution
+
+        // over all views: total time, mean scores
+        double seconds = 0.0;
+        double agreement = 0.0;
+        double colorError = 0.0;
+        bool pareto = false;
+    };
+
+    std::vector<Candidate> candidates(bool gpu) {
+        const float tolerances[] = {1e-3f, 1e-4f, 1e-5f, 1e-6f};
+        const int budgets[] = {15000, 60000};
+        const unsigned divisors[] = {1, 2};
+
+        std::vector<Candidate> list;
+        for (const unsigned divisor : divisors) {
+            for (const int steps : budgets) {
+                for (const float tolerance : tolerances) {
+                    list.push_back({"cpu", "rk45", tolerance, steps, divisor});
+                    if (!gpu) continue;
+                    list.push_back({"gpu", "rk45", tolerance, steps, divisor});
+                    list.push_back({"gpu", "planar", tolerance, steps, divisor});
+                }
+            }
+            if (!gpu) continue;
+            list.push_back({"gpu", "adaptive", 1e-5f, 60000, divisor});
+            list.push_back({"gpu", "wavefront", 1e-5f, 60000, divisor});
+            list.push_back({"gpu", "table", 1e-5f, 60000, divisor});
+        }
+        return list;
+    }
+
+    // The class of a texel from its colour, see CpuTracer::shade: transparent is an
+    // escaped ray, opaque black the hole (or a black object), full red with blue 0.2 and
+    // green = alpha the disk, anything else an object.
+    HitClass classOf(const std::uint8_t* texel) {
+        if (texel[3] == 0) return HitClass::Escape;
+        if (texel[0] == 0 && texel[1] == 0 && texel[2] == 0) return HitClass::BlackHole;
+        if (texel[0] == 255 && texel[2] == 51 && texel[1] == texel[3]) return HitClass::Disk;
+        return HitClass::Object;
+    }
+
+    // Nearest candidate texel for every reference pixel, so a lower resolution pays for
+    // the detail it cannot show. Adds the share of matching hit classes and the mean
+    // RGB error (0..1) to the candidate.
+    void score(Candidate& candidate, const std::vector<std::uint8_t>& reference, sf::Vector2u size,
+               const std::vector<std::uint8_t>& rgba, sf::Vector2u traced) {
+        size_t agree = 0;
+        double error = 0.0;
+        for (unsigned y = 0; y < size.y; ++y) {
+            for (unsigned x = 0; x < size.x; ++x) {
+                const std::uint8_t* want = &reference[((size_t)y * size.x + x) * 4];
+                const unsigned tx = std::min(x * traced.x / size.x, traced.x - 1);
+                const unsigned ty = std::min(y * traced.y / size.y, traced.y - 1);
+                const std::uint8_t* got = &rgba[((size_t)ty * traced.x + tx) * 4];
+                agree += classOf(want) == classOf(got);
+                for (int c = 0; c < 3; ++c) error += std::abs((int)want[c] - (int)got[c]) / 255.0;
+            }
+        }
+        const double pixels = (double)size.x * size.y;
+        candidate.agreement += (double)agree / pixels / std::size(views);
+        candidate.colorError += error / (3.0 * pixels) / std::size(views);
+    }
+
+    double renderCpu(CpuTracer& tracer, const Candidate& candidate, const CameraFrame& cam, const Scene& scene,
+                     sf::Vector2u traced, int reps, std::vector<std::uint8_t>& rgba) {
+        tracer.staticSteps = candidate.steps;
+        const DiskParams disk = DiskParams::around(scene.hole.r_s);
+        return median(reps, [&] {
+            tracer.render(cam, disk, scene.objects, candidate.tolerance, traced, rgba);
+        });
+    }
+
+    double renderGpu(Engine& engine, const Candidate& candidate, const Camera& camera, const Scene& scene,
+                     sf::Vector2u traced, int reps, std::vector<std::uint8_t>& rgba) {
+        engine.computeSize = traced;
+        engine.tolerance = candidate.tolerance;
+        engine.staticSteps = candidate.steps;
+        engine.useAdaptiveSampling = std::string(candidate.kernel) == "adaptive";
+        engine.usePlanarKernel = std::string(candidate.kernel) == "planar";
+        engine.useWavefront = std::string(candidate.kernel) == "wavefront";
+        engine.useDeflectionTable = std::string(candidate.kernel) == "table";
+        const double seconds = median(reps, [&] {
+            engine.invalidate();
+            do {
+                engine.dispatchCompute(camera, scene.hole, scene.objects);
+            } while (!engine.isTextureReady);
+            glFinish();
+        });
+        engine.readTraced(rgba);
+        return seconds;
+    }
+
+    // not beaten by another candidate on time, agreement and colour error at once
+    void markPareto(std::vector<Candidate>& list) {
+        for (Candidate& a : list) {
+            a.pareto = std::none_of(list.begin(), list.end(), [&](const Candidate& b) {
+                const bool noWorse = b.seconds <= a.seconds && b.agreement >= a.agreement
+                                     && b.colorError <= a.colorError;
+                const bool better = b.seconds < a.seconds || b.agreement > a.agreement
+                                    || b.colorError < a.colorError;
+                return noWorse && better;
+            });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string out = "accuracy.json", sceneFile;
+    int reps = 3;
+    sf::Vector2u size{320, 240};
+    bool cpuOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) out = argv[++i];
+        else if (arg == "--reps" && hasValue) reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--scene" && hasValue) sceneFile = argv[++i];
+        else if (arg == "--size" && hasValue && std::sscanf(argv[++i], "%ux%u", &size.x, &size.y) == 2
+                 && size.x > 0 && size.y > 0) continue;
+        else if (arg == "--cpu-only") cpuOnly = true;
+        else {
+            std::cerr << "Usage: BlackHoleAccuracy [--out <file>] [--reps <n>] [--size <w>x<h>] [--scene <file>]"
+                         " [--cpu-only]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const Scene scene = sceneFile.empty() ? Scene::sagittarius() : Scene::load(sceneFile);
+    ThreadPool pool;
+    CpuTracer tracer(pool);
+    std::unique_ptr<Engine> engine;
+    if (!cpuOnly) {
+        engine = std::make_unique<Engine>(size);
+        if (engine->useCpuTracer) engine.reset(); // no compute shaders, the CPU rows cover it
+    }
+    std::vector<Candidate> list = candidates(engine != nullptr);
+
+    double referenceSeconds = 0.0;
+    std::vector<std::uint8_t> reference, rgba;
+    for (const View& view : views) {
+        const Camera camera(view.radius, view.elevation, view.azimuth);
+        const CameraFrame cam = CameraFrame::lookAt(camera.position(), camera.target, 60.0f,
+                                                    (float)size.x / (float)size.y, false);
+        const auto t0 = Clock::now();
+        renderReference(pool, cam, scene, size, reference);
+        referenceSeconds += std::chrono::duration<double>(Clock::now() - t0).count();
+
+        for (Candidate& candidate : list) {
+            const sf::Vector2u traced(std::max(1u, size.x / candidate.divisor), std::max(1u, size.y / candidate.divisor));
+            candidate.seconds += std::string(candidate.tracer) == "cpu"
+                ? renderCpu(tracer, candidate, cam, scene, traced, reps, rgba)
+                : renderGpu(*engine, candidate, camera, scene, traced, reps, rgba);
+            score(candidate, reference, size, rgba, traced);
+        }
+    }
+    markPareto(list);
+    std::sort(list.begin(), list.end(), [](const Candidate& a, const Candidate& b) { return a.seconds < b.seconds; });
+
+    std::ostringstream json;
+    json << "{\n  \"width\": " << size.x << ", \"height\": " << size.y << ", \"views\": " << std::size(views)
+         << ",\n  \"reference_seconds\": " << referenceSeconds << ",\n  \"candidates\": [\n";
+    std::printf("%-4s %-9s %9s %6s %9s %10s %9s %9s\n", "", "kernel", "tolerance", "steps", "size", "ms", "agree",
+                "color");
+    for (size_t i = 0; i < list.size(); ++i) {
+        const Candidate& c = list[i];
+        const unsigned w = std::max(1u, size.x / c.divisor), h = std::max(1u, size.y / c.divisor);
+        json << "    {\"tracer\": \"" << c.tracer << "\", \"kernel\": \"" << c.kernel
+             << "\", \"tolerance\": " << c.tolerance << ", \"steps\": " << c.steps
+             << ", \"width\": " << w << ", \"height\": " << h << ", \"seconds\": " << c.seconds
+             << ", \"class_agreement\": " << c.agreement << ", \"color_error\": " << c.colorError
+             << ", \"pareto\": " << (c.pareto ? "true" : "false") << "}"
+             << (i + 1 < list.size() ? ",\n" : "\n");
+        const std::string traced = std::to_string(w) + "x" + std::to_string(h);
+        std::printf("%-4s %-9s %9.0e %6d %9s %10.2f %9.5f %9.5f %s\n", c.tracer, c.kernel, c.tolerance, c.steps,
+                    traced.c_str(), c.seconds * 1e3, c.agreement, c.colorError, c.pareto ? "pareto" : "");
+    }
+    json << "  ]\n}\n";
+
+    std::ofstream file(out);
+    file << json.str();
+    if (!file) {
+        std::cerr << "Failed to write " << out << std::endl;
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Headless renderer for camera paths: traces every frame with CpuTracer, no window
+// or GL context, and hands the frames to a FrameWriter thread.
+
+// ---- STL
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CpuTracer.h"
+#include "FrameParams.h"
+#include "FrameWriter.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+struct PathFrame {
+    glm::vec3 position;
+    glm::vec3 target;
+    float fov; // vertical, degrees
+};
+
+// One frame per line: <px> <py> <pz> <tx> <ty> <tz> <fov>, '#' starts a comment
+std::vector<PathFrame> loadPath(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open camera path " << path << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<PathFrame> frames;
+    std::string line;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        PathFrame f{};
+        if (!(fields >> f.position.x)) continue;
+        if (!(fields >> f.position.y >> f.position.z >> f.target.x >> f.target.y >> f.target.z >> f.fov)) {
+            std::cerr << path << ":" << lineNo << ": expected px py pz tx ty tz fov" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        frames.push_back(f);
+    }
+    return frames;
+}
+
+// A full turn around the hole at the interactive camera's start radius, just above the disk
+std::vector<PathFrame> orbitPath(int count) {
+    constexpr float radius = 6.34194e10f;
+    constexpr float elevation = 1.45f;
+    std::vector<PathFrame> frames;
+    for (int i = 0; i < count; ++i) {
+        const float azimuth = 2.0f * 3.14159265f * (float)i / (float)count;
+        const glm::vec3 pos(radius * std::sin(elevation) * std::cos(azimuth),
+                            radius * std::cos(elevation),
+                            radius * std::sin(elevation) * std::sin(azimuth));
+        frames.push_back({pos, glm::vec3(0.0f), 60.0f});
+    }
+    return frames;
+}
+
+void usage() {
+    std::cerr << "Usage: BlackHoleBatch (<camera path> | --orbit <frames>) [options]\n"
+                 "  --scene <file>        scene file, text or binary, see Scene.h (default: Sagittarius A)\n"
+                 "  --size <w>x<h>        frame size (default 800x600)\n"
+                 "  --out <prefix>        output path prefix (default frame_)\n"
+                 "  --format raw|ppm|png  (default ppm)\n"
+                 "  --tolerance <t>       integrator error bound (default 1e-5)\n"
+                 "  --queue <n>           frames allowed to wait for the writer (default 4)" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    std::string pathFile, sceneFile, prefix = "frame_";
+    int orbitFrames = 0;
+    sf::Vector2u size{800, 600};
+    FrameWriter::Format format = FrameWriter::Format::Ppm;
+    float tolerance = 1e-5f;
+    std::size_t queue = 4;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--orbit" && hasValue) {
+            orbitFrames = std::atoi(argv[++i]);
+        } else if (arg == "--scene" && hasValue) {
+            sceneFile = argv[++i];
+        } else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%ux%u", &size.x, &size.y) != 2 || size.x == 0 || size.y == 0) usage();
+        } else if (arg == "--out" && hasValue) {
+            prefix = argv[++i];
+        } else if (arg == "--format" && hasValue) {
+            const std::string name = argv[++i];
+            if (name == "raw") format = FrameWriter::Format::Raw;
+            else if (name == "ppm") format = FrameWriter::Format::Ppm;
+            else if (name == "png") format = FrameWriter::Format::Png;
+            else usage();
+        } else if (arg == "--tolerance" && hasValue) {
+            tolerance = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--queue" && hasValue) {
+            queue = (std::size_t)std::atoi(argv[++i]);
+        } else if (arg[0] != '-' && pathFile.empty()) {
+            pathFile = arg;
+        } else {
+            usage();
+        }
+    }
+    if (pathFile.empty() == (orbitFrames <= 0)) usage();
+
+    const Scene scene = sceneFile.empty() ? Scene::sagittarius() : Scene::load(sceneFile);
+    const std::vector<PathFrame> path = pathFile.empty() ? orbitPath(orbitFrames) : loadPath(pathFile);
+    const DiskParams disk = DiskParams::around(scene.hole.r_s);
+    const float aspect = (float)size.x / (float)size.y;
+
+    ThreadPool workers;
+    CpuTracer tracer(workers);
+    std::cout << "Rendering " << path.size() << " frames of " << size.x << "x" << size.y
+              << " on " << workers.size() << " threads" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    double renderSeconds = 0.0;
+    {
+        FrameWriter writer(prefix, format, queue);
+        for (std::size_t i = 0; i < path.size(); ++i) {
+            const CameraFrame cam = CameraFrame::lookAt(path[i].position, path[i].target, path[i].fov, aspect, false);
+
+            const auto t0 = Clock::now();
+            std::vector<std::uint8_t> rgba;
+            tracer.render(cam, disk, scene.objects, tolerance, size, rgba);
+            const double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+            renderSeconds += seconds;
+
+            std::cout << "frame " << i + 1 << "/" << path.size() << "  " << seconds << " s" << std::endl;
+            if (!writer.push((int)i, size, std::move(rgba))) break;
+        }
+        if (!writer.finish()) {
+            std::cerr << writer.error() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const double total = std::chrono::duration<double>(Clock::now() - start).count();
+    const double rays = (double)size.x * size.y * (double)path.size();
+    std::cout << "Done in " << total << " s: " << 3600.0 * (double)path.size() / total << " frames/hour, "
+              << rays / renderSeconds * 1e-6 << " Mrays/s while tracing" << std::endl;
+    return 0;
+}
@@ -0,0 +1,283 @@
+// Fixed-scene benchmarks with JSON output, see the `bench` target in CMakeLists.txt.
+//   BlackHoleBench [--out <file>] [--reps <n>] [--cpu-only]
+// GPU timings are wall clock around glFinish, so they include driver overhead.
+
+// ---- OpenGL loader first
+#include <GL/glew.h>
+
+// ---- STL
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+#include "CpuTracer.h"
+#include "Engine.h"
+#include "FrameParams.h"
+#include "NBody.h"
+#include "Scene.h"
+#include "Simd.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // median wall time of fn over reps runs, seconds
+    template<typename Fn>
+    double median(int reps, Fn&& fn) {
+        std::vector<double> times;
+        for (int i = 0; i < reps; ++i) {
+            const auto t0 = Clock::now();
+            fn();
+            times.push_back(std::chrono::duration<double>(Clock::now() - t0).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    // s as the contents of a JSON string, "unknown" for null
+    std::string jsonString(const char* s) {
+        if (!s) return "unknown";
+        std::string out;
+        for (; *s; ++s) {
+            const unsigned char c = *s;
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            } else if (c < 0x20) {
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+                out += hex;
+            } else {
+                out += (char)c;
+            }
+        }
+        return out;
+    }
+
+    struct View {
+        const char* name;
+        float radius, elevation, azimuth;
+    };
+
+    constexpr View views[] = {
+        {"edge-on", 6.34194e10f, 1.50f, 0.4f},
+        {"above",   6.34194e10f, 0.60f, 0.4f},
+        {"far",     3.0e11f,     1.30f, 1.0f},
+    };
+
+    CameraFrame viewFrame(const View& view, float aspect) {
+        const glm::vec3 pos(view.radius * std::sin(view.elevation) * std::cos(view.azimuth),
+                            view.radius * std::cos(view.elevation),
+                            view.radius * std::sin(view.elevation) * std::sin(view.azimuth));
+        return CameraFrame::lookAt(pos, glm::vec3(0.0f), 60.0f, aspect, false);
+    }
+
+    // the default scene plus `count - 3` small bodies on a ring, always the same
+    std::vector<ObjectData> ringScene(const Scene& base, int count) {
+        std::vector<ObjectData> objs = base.objects;
+        for (int i = (int)objs.size(); i < count; ++i) {
+            const float a = 2.4f * (float)i, d = 3e11f + 5e9f * (float)i;
+            objs.push_back({glm::vec4(d * std::cos(a), 2e10f * (float)(i % 3 - 1), d * std::sin(a), 1e10f),
+                            glm::vec4(1, (float)(i % 2), 0, 1), 2e30f});
+        }
+        objs.resize(count);
+        return objs;
+    }
+
+    void cpuTrace(std::ostream& json, const Scene& scene, int reps) {
+        ThreadPool pool;
+        CpuTracer tracer(pool);
+        const DiskParams disk = DiskParams::around(scene.hole.r_s);
+        const sf::Vector2u size{320, 240};
+        const sf::Vector2u scalarSize{64, 48};
+        std::vector<std::uint8_t> rgba;
+
+        json << "  \"threads\": " << pool.size() << ",\n"
+             << "  \"simd_width\": " << simd::width << ",\n"
+             << "  \"cpu_trace\": [\n";
+        for (size_t v = 0; v < std::size(views); ++v) {
+            const CameraFrame cam = viewFrame(views[v], 4.0f / 3.0f);
+            const double packet = median(reps, [&] {
+                tracer.render(cam, disk, scene.objects, 1e-5f, size, rgba);
+            });
+            // scalar reference path, one thread, smaller frame
+            const double scalar = median(reps, [&] {
+                for (unsigned y = 0; y < scalarSize.y; ++y)
+                    for (unsigned x = 0; x < scalarSize.x; ++x)
+                        tracer.tracePixel(cam, disk, scene.objects, 1e-5f, scalarSize, x, y);
+            });
+            json << "    {\"view\": \"" << views[v].name << "\", \"width\": " << size.x << ", \"height\": " << size.y
+                 << ", \"seconds\": " << packet
+                 << ", \"rays_per_second\": " << size.x * size.y / packet
+                 << ", \"scalar_rays_per_second\": " << scalarSize.x * scalarSize.y / scalar << "}"
+                 << (v + 1 < std::size(views) ? ",\n" : "\n");
+        }
+        json << "  ]";
+    }
+
+    // simulation step time for a disk of bodies on circular orbits around the hole
+    void nbody(std::ostream& json, const Scene& scene, int reps) {
+        constexpr double G = 6.67430e-11;
+        constexpr int counts[] = {1000, 10000, 50000};
+        ThreadPool pool;
+
+        json << ",\n  \"nbody\": [\n";
+        for (size_t c = 0; c < std::size(counts); ++c) {
+            std::vector<ObjectData> objs;
+            for (int i = 0; i < counts[c]; ++i) {
+                const double a = 2.399963 * i, d = 2e11 + 2e12 * std::sqrt((i + 0.5) / counts[c]);
+                const double v = std::sqrt(G * scene.hole.mass / d);
+                objs.push_back({glm::vec4((float)(d * std::cos(a)), 1e9f * (float)(i % 5 - 2), (float)(d * std::sin(a)), 1e9f),
+                                glm::vec4(1), 2e30f, glm::vec3((float)(-v * std::sin(a)), 0.0f, (float)(v * std::cos(a)))});
+            }
+            NBody simulation(scene.hole, objs, pool);
+            simulation.step(); // first tree build allocates
+            const double seconds = median(reps, [&] { simulation.step(); });
+            json << "    {\"bodies\": " << counts[c] << ", \"step_ms\": " << seconds * 1e3 << "}"
+                 << (c + 1 < std::size(counts) ? ",\n" : "\n");
+        }
+        json << "  ]";
+    }
+
+    void gpu(std::ostream& json, const Scene& scene, int reps) {
+        Engine engine{{640, 480}};
+        const Camera camera;
+        json << ",\n  \"gl_renderer\": \"" << jsonString((const char*)glGetString(GL_RENDERER)) << "\"";
+
+        // a full frame is sampleStride^2 progressive passes (maybe sliced), or one adaptive one;
+        // planar is progressive with the orbit-equation kernel, wavefront progressive in step chunks
+        engine.computeSize = {640, 480};
+        json << ",\n  \"gpu_trace\": [\n";
+        const char* modes[] = {"progressive", "adaptive", "planar", "wavefront"};
+        for (size_t m = 0; m < std::size(modes); ++m) {
+            engine.useAdaptiveSampling = m == 1;
+            engine.usePlanarKernel = m == 2;
+            engine.useWavefront = m == 3;
+            const double seconds = median(reps, [&] {
+                engine.invalidate();
+                do {
+                    engine.dispatchCompute(camera, scene.hole, scene.objects);
+                } while (!engine.isTextureReady);
+                glFinish();
+            });
+            json << "    {\"mode\": \"" << modes[m]
+                 << "\", \"width\": 640, \"height\": 480, \"seconds\": " << seconds
+                 << ", \"rays_per_second\": " << 640.0 * 480.0 / seconds << "}"
+                 << (m + 1 < std::size(modes) ? ",\n" : "\n");
+        }
+        json << "  ]";
+        engine.useAdaptiveSampling = false;
+        engine.usePlanarKernel = false;
+        engine.useWavefront = false;
+
+        // generateGrid with the masses moved every run, so it never takes the clean early-out
+        json << ",\n  \"grid\": [\n";
+        const int objectCounts[] = {1, 16, 64};
+        const int cellCounts[] = {25, 100, 400};
+        for (size_t o = 0; o < std::size(objectCounts); ++o) {
+            std::vector<ObjectData> objs = ringScene(scene, objectCounts[o]);
+            for (size_t c = 0; c < std::size(cellCounts); ++c) {
+                engine.gridCells = cellCounts[c];
+                engine.generateGrid(objs);
+                const double generate = median(reps, [&] {
+                    objs[0].posRadius.x += 1.0f;
+                    engine.generateGrid(objs);
+                    glFinish();
+                });
+                const double draw = median(reps, [&] {
+                    engine.drawGrid(camera);
+                    glFinish();
+                });
+                json << "    {\"objects\": " << objectCounts[o] << ", \"cells\": " << cellCounts[c]
+                     << ", \"generate_ms\": " << generate * 1e3 << ", \"draw_ms\": " << draw * 1e3 << "}"
+                     << (o + 1 < std::size(objectCounts) || c + 1 < std::size(cellCounts) ? ",\n" : "\n");
+            }
+        }
+        json << "  ]";
+        engine.gridCells = 25;
+
+        // uploads skip unchanged data, so time both an unchanged and an alternating input
+        constexpr int calls = 1000;
+        const auto perCall = [&](auto&& upload) {
+            return median(reps, [&] {
+                for (int i = 0; i < calls; ++i) upload(i);
+                glFinish();
+            }) / calls * 1e6;
+        };
+        Camera zoomed;
+        zoomed.processScroll(0.0f, 1.0f);
+        const Camera* cameras[2] = {&camera, &zoomed};
+        const BlackHole holes[2] = {scene.hole, BlackHole(scene.hole.position, (float)scene.hole.mass * 1.01f)};
+        std::vector<ObjectData> movedObjects = scene.objects;
+        movedObjects[0].posRadius.x += 1e9f;
+        const std::vector<ObjectData>* objects[2] = {&scene.objects, &movedObjects};
+        json << ",\n  \"uploads_us\": {"
+             << "\"camera\": " << perCall([&](int) { engine.uploadCameraUBO(camera); })
+             << ", \"camera_changed\": " << perCall([&](int i) { engine.uploadCameraUBO(*cameras[i % 2]); })
+             << ", \"objects\": " << perCall([&](int) { engine.uploadObjects(scene.objects, (float)scene.hole.r_s); })
+             << ", \"objects_changed\": " << perCall([&](int i) { engine.uploadObjects(*objects[i % 2], (float)scene.hole.r_s); })
+             << ", \"disk\": " << perCall([&](int) { engine.uploadDiskUBO(scene.hole); })
+             << ", \"disk_changed\": " << perCall([&](int i) { engine.uploadDiskUBO(holes[i % 2]); }) << "}";
+
+        // into the 640x480 window from the full, half and third traced resolution
+        json << ",\n  \"blit\": [\n";
+        const float sigmas[] = {0.5f, 1.0f, 2.0f, 3.0f, 4.0f};
+        const unsigned divisors[] = {1, 2, 3};
+        for (size_t d = 0; d < std::size(divisors); ++d) {
+            engine.computeSize = {640 / divisors[d], 480 / divisors[d]};
+            engine.dispatchCompute(camera, scene.hole, scene.objects); // allocates the targets
+            for (size_t i = 0; i < std::size(sigmas); ++i) {
+                engine.blitSigma = sigmas[i];
+                const double seconds = median(reps, [&] {
+                    for (int k = 0; k < 20; ++k) engine.drawFullScreenQuad();
+                    glFinish();
+                }) / 20;
+                json << "    {\"sigma\": " << sigmas[i] << ", \"width\": 640, \"height\": 480"
+                     << ", \"compute_width\": " << engine.computeSize.x << ", \"compute_height\": " << engine.computeSize.y
+                     << ", \"ms\": " << seconds * 1e3 << "}"
+                     << (d + 1 < std::size(divisors) || i + 1 < std::size(sigmas) ? ",\n" : "\n");
+            }
+        }
+        json << "  ]";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string out = "bench.json";
+    int reps = 5;
+    bool cpuOnly = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) out = argv[++i];
+        else if (arg == "--reps" && i + 1 < argc) reps = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--cpu-only") cpuOnly = true;
+        else {
+            std::cerr << "Usage: BlackHoleBench [--out <file>] [--reps <n>] [--cpu-only]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const Scene scene = Scene::sagittarius();
+    std::ostringstream json;
+    json << "{\n";
+    cpuTrace(json, scene, reps);
+    nbody(json, scene, reps);
+    if (!cpuOnly) gpu(json, scene, reps);
+    json << "\n}\n";
+
+    std::ofstream file(out);
+    file << json.str();
+    if (!file) {
+        std::cerr << "Failed to write " << out << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << json.str();
+    return 0;
+}
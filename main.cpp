@@ -10,100 +10,297 @@
 #include <glm/gtc/type_ptr.hpp>
 
 // ---- STL
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "Camera.h"
 #include "BlackHole.h"
 #include "Engine.h"
+#include "FrameBudget.h"
+#include "FrameProfiler.h"
+#include "Mailbox.h"
+#include "NBody.h"
 #include "ObjectData.h"
+#include "Scene.h"
+#include "ThreadPool.h"
 
-void processEvents(const std::optional<sf::Event>& event, Engine& engine, Camera& camera);
-void draw(Engine& engine, const Camera& camera, const std::vector<ObjectData>& objects, const BlackHole& hole);
+constexpr auto windowTitle = "Black Hole (SFML + OpenGL)";
 
-int main() {
+// Everything the render thread takes from the input thread, published whole through a Mailbox.
+// The objects are not in here: the simulation moves them on the render thread.
+struct ViewState {
     Camera camera;
-    const BlackHole SagA(glm::vec3(0.0f, 0.0f, 0.0f), 8.54e36); // Sagittarius A
-    const std::vector<ObjectData> objects = {
-        { glm::vec4(4e11f, 0.0f, 0.0f, 4e10f)   , glm::vec4(1,1,0,1), 1.98892e30f },
-        { glm::vec4(0.0f, 0.0f, 4e11f, 4e10f)   , glm::vec4(1,0,0,1), 1.98892e30f },
-        { glm::vec4(0.0f, 0.0f, 0.0f, (float)SagA.r_s) , glm::vec4(0,0,0,1), (float)SagA.mass  },
-    };
+    sf::Vector2u windowSize{0, 0};
+    bool useCpuTracer = false;
+    bool useDeflectionTable = false;
+    bool useAdaptiveSampling = false;
+    bool usePlanarKernel = false;
+    bool useWavefront = false;
+    bool showDisk = true;
+    // `B` toggles it; while on, `+`/`-` change the budget instead of the resolution
+    bool useBudget = true;
+    float budgetMs = 10.f;
+    int resolutionShift = 0; // without the budget: window size times 2^shift
+    bool simulate = false;   // `Space`, N-body motion of the objects
+    bool showTimings = false; // `P`, stage timings in the window title
+    unsigned timingWrites = 0; // `O` presses
+    bool running = true;
+};
+
+// Wakes an idle render thread after a publish; the state itself never takes the lock
+struct Wakeup {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void notify() {
+        std::lock_guard lock(mutex);
+        cv.notify_one();
+    }
+};
+
+// true when the event changed the ViewState; camera changes come through camera.changed
+bool processEvents(const sf::Event& event, sf::Window& window, ViewState& state);
+void render(Engine& engine, Scene& scene, Mailbox<ViewState>& views, Mailbox<std::string>& titles, Wakeup& wakeup);
+void draw(Engine& engine, const Camera& camera, sf::Vector2u windowSize, const std::vector<ObjectData>& objects,
+          const BlackHole& hole, FrameProfiler& profiler);
+
+// The main thread owns the window and its events, the render thread the GL context,
+// the simulation and the frame budget. Input goes over as ViewState snapshots, so a
+// slow frame never holds up the next event; window titles come back the same way.
+int main(int argc, char** argv) {
+    Scene scene = argc > 1 ? Scene::load(argv[1]) : Scene::sagittarius();
     Engine engine{{800, 600}};
 
-    sf::Clock sfClock;
-    while (engine.window->isOpen()) {
-        camera.resizing = false;
-        camera.scrolling = false; // need to reset cuz there is no way to know if scroll stopped
+    ViewState state;
+    state.windowSize = engine.window->getSize();
+    state.useCpuTracer = engine.useCpuTracer;
+    state.showDisk = engine.showDisk;
+    state.budgetMs = FrameBudget{}.budgetMs;
+
+    Mailbox<ViewState> views;
+    Mailbox<std::string> titles;
+    Wakeup wakeup;
+    views.back() = state;
+    views.publish();
+    engine.window->setActive(false);
+    std::thread renderer(render, std::ref(engine), std::ref(scene), std::ref(views), std::ref(titles), std::ref(wakeup));
+
+    while (state.running) {
+        // there is no event for the end of a scroll or resize, and the title wants updates
+        const bool settling = state.camera.moving && !state.camera.dragging;
+        const sf::Time timeout = settling ? sf::milliseconds(50)
+                               : state.showTimings ? sf::milliseconds(500) : sf::Time::Zero; // no timeout
+        const bool wasMoving = state.camera.moving;
+        state.camera.resizing = false;
+        state.camera.scrolling = false;
+
+        bool changed = false;
+        if (const std::optional event = engine.window->waitEvent(timeout))
+            changed |= processEvents(*event, *engine.window, state);
         while (const std::optional event = engine.window->pollEvent())
-            processEvents(event, engine, camera);
-        camera.update();
+            changed |= processEvents(*event, *engine.window, state);
+        state.camera.update();
+        changed |= state.camera.changed || state.camera.moving != wasMoving;
+        state.camera.changed = false;
 
-        // --- Dynamic resolution ---
-        const float dt = sfClock.restart().asSeconds();
-        const sf::Vector2u size = engine.window->getSize();
-        if (camera.moving) {
-            if (engine.isTextureReady) {
-                engine.isTextureReady = false;
-                engine.computeSize.x = std::max(engine.computeSize.x * 1u / 2u, size.x / 32u);
-                engine.computeSize.y = std::max(engine.computeSize.y * 1u / 2u, size.y / 32u);
-            } else if (dt > 1.f / 24.f) {
-                engine.computeSize.x = std::max(engine.computeSize.x * 3u / 4u, size.x / 32u);
-                engine.computeSize.y = std::max(engine.computeSize.y * 3u / 4u, size.y / 32u);
-            }
-        } else if (dt < 1.f / 8.f && !engine.isTextureReady) {
-            engine.computeSize.x = std::min(engine.computeSize.x * 4u / 3u, size.x);
-            engine.computeSize.y = std::min(engine.computeSize.y * 4u / 3u, size.y);
-        } else {
-            engine.isTextureReady = true;
-            sf::sleep(sf::seconds(1.f / 24.f - dt));
-            continue;
+        if (changed) {
+            views.back() = state;
+            views.publish();
+            wakeup.notify();
         }
-
-        draw(engine, camera, objects, SagA);
+        if (titles.fetch() && state.showTimings)
+            engine.window->setTitle(titles.front());
     }
 
+    renderer.join();
+    engine.window->setActive(true); // for ~Engine
+    engine.window->close();
     return 0;
 }
 
-void processEvents(const std::optional<sf::Event>& event, Engine& engine, Camera& camera) {
-    if (event->is<sf::Event::Closed>()) {
-        engine.window->close();
-    } else if (const auto* resized = event->getIf<sf::Event::Resized>()) {
+bool processEvents(const sf::Event& event, sf::Window& window, ViewState& state) {
+    Camera& camera = state.camera;
+    if (event.is<sf::Event::Closed>()) {
+        state.running = false;
+    } else if (event.is<sf::Event::FocusGained>()) {
+        return true; // the window may have been covered
+    } else if (const auto* resized = event.getIf<sf::Event::Resized>()) {
         camera.resizing = true;
-        engine.isTextureReady = false;
-    } else if (const auto* moved = event->getIf<sf::Event::MouseMoved>()) {
+        state.windowSize = resized->size;
+    } else if (const auto* moved = event.getIf<sf::Event::MouseMoved>()) {
         camera.processMouseMove((float)moved->position.x, (float)moved->position.y);
-    } else if (const auto* pressed = event->getIf<sf::Event::MouseButtonPressed>()) {
-        camera.processMouseButton(pressed->button, true, *engine.window);
-    } else if (const auto* released = event->getIf<sf::Event::MouseButtonReleased>()) {
-        camera.processMouseButton(released->button, false, *engine.window);
-    } else if (const auto* scrolled = event->getIf<sf::Event::MouseWheelScrolled>()) {
+        return false;
+    } else if (const auto* pressed = event.getIf<sf::Event::MouseButtonPressed>()) {
+        camera.processMouseButton(pressed->button, true, window);
+        return false;
+    } else if (const auto* released = event.getIf<sf::Event::MouseButtonReleased>()) {
+        camera.processMouseButton(released->button, false, window);
+        return false;
+    } else if (const auto* scrolled = event.getIf<sf::Event::MouseWheelScrolled>()) {
         camera.processScroll(0.0, scrolled->delta);
-    } else if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>()) {
+        return false;
+    } else if (const auto* keyPressed = event.getIf<sf::Event::KeyPressed>()) {
         camera.processKey(keyPressed->scancode, true);
-    } else if (const auto* keyReleased = event->getIf<sf::Event::KeyReleased>()) {
-        if (keyReleased->scancode == sf::Keyboard::Scancode::Equal)
-            engine.computeSize *= 2u;
-        if (keyReleased->scancode == sf::Keyboard::Scancode::Hyphen)
-            engine.computeSize /= 2u;
+        return false;
+    } else if (const auto* keyReleased = event.getIf<sf::Event::KeyReleased>()) {
+        if (keyReleased->scancode == sf::Keyboard::Scancode::Equal) {
+            if (state.useBudget) state.budgetMs = std::min(state.budgetMs * 2.f, 1000.f);
+            else state.resolutionShift = std::min(state.resolutionShift + 1, 2);
+        }
+        if (keyReleased->scancode == sf::Keyboard::Scancode::Hyphen) {
+            if (state.useBudget) state.budgetMs = std::max(state.budgetMs / 2.f, 1.f);
+            else state.resolutionShift = std::max(state.resolutionShift - 1, -8);
+        }
+        if (keyReleased->scancode == sf::Keyboard::Scancode::B) {
+            state.useBudget = !state.useBudget;
+            std::cout << (state.useBudget ? "Frame budget " + std::to_string(state.budgetMs) + " ms"
+                                          : "Manual resolution") << std::endl;
+        }
+        if (keyReleased->scancode == sf::Keyboard::Scancode::C) state.useCpuTracer = !state.useCpuTracer;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::T) state.useDeflectionTable = !state.useDeflectionTable;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::A) state.useAdaptiveSampling = !state.useAdaptiveSampling;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::K) state.usePlanarKernel = !state.usePlanarKernel;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::W) state.useWavefront = !state.useWavefront;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::D) state.showDisk = !state.showDisk;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::Space) state.simulate = !state.simulate;
+        if (keyReleased->scancode == sf::Keyboard::Scancode::P) {
+            state.showTimings = !state.showTimings;
+            if (!state.showTimings) window.setTitle(windowTitle);
+        }
+        if (keyReleased->scancode == sf::Keyboard::Scancode::O) ++state.timingWrites;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void render(Engine& engine, Scene& scene, Mailbox<ViewState>& views, Mailbox<std::string>& titles, Wakeup& wakeup) {
+    engine.window->setActive(true);
+    ThreadPool simWorkers;
+    NBody simulation(scene.hole, scene.objects, simWorkers);
+    FrameProfiler profiler;
+    FrameBudget budget;
+
+    ViewState view; // the state the image is rendered for
+    sf::Clock sfClock;
+    unsigned drawnFrames = 0;
+    bool redraw = true;
+    // Render on demand: draw only while something changed or the view is still refining,
+    // otherwise sleep until the next ViewState or simulation step
+    while (true) {
+        if (views.fetch()) {
+            const ViewState& next = views.front();
+            if (!next.running) break;
+
+            const bool retrace = next.useCpuTracer != engine.useCpuTracer
+                                 || next.useDeflectionTable != engine.useDeflectionTable
+                                 || next.useAdaptiveSampling != engine.useAdaptiveSampling
+                                 || next.usePlanarKernel != engine.usePlanarKernel
+                                 || next.useWavefront != engine.useWavefront
+                                 || next.showDisk != engine.showDisk || next.windowSize != view.windowSize;
+            engine.useCpuTracer = next.useCpuTracer;
+            engine.useDeflectionTable = next.useDeflectionTable;
+            engine.useAdaptiveSampling = next.useAdaptiveSampling;
+            engine.usePlanarKernel = next.usePlanarKernel;
+            engine.useWavefront = next.useWavefront;
+            engine.showDisk = next.showDisk;
+            if (retrace) engine.invalidate();
+
+            budget.budgetMs = next.budgetMs;
+            if (next.windowSize != view.windowSize || next.useBudget != view.useBudget
+                || next.resolutionShift != view.resolutionShift) {
+                const sf::Vector2u window = next.windowSize;
+                const int shift = next.resolutionShift;
+                engine.computeSize = next.useBudget ? budget.size(window)
+                                   : shift >= 0 ? sf::Vector2u(window.x << shift, window.y << shift)
+                                                : sf::Vector2u(std::max(window.x >> -shift, 1u),
+                                                               std::max(window.y >> -shift, 1u));
+            }
+            if (next.timingWrites != view.timingWrites) {
+                if (profiler.writeCsv("frame_timings.csv") && profiler.writeJson("frame_timings.json"))
+                    std::cout << "Wrote frame_timings.csv and frame_timings.json" << std::endl;
+                else
+                    std::cerr << "Failed to write frame timings" << std::endl;
+            }
+            view = next;
+            redraw = true;
+        }
+
+        // --- Progressive refinement: draw until every pixel of a still view is traced ---
+        const float dt = sfClock.restart().asSeconds();
+        if (view.simulate && simulation.advance(dt) > 0) {
+            simulation.writeTo(scene.objects);
+            engine.markObjectsMoved();
+            redraw = true;
+        }
+        if (!redraw && !view.camera.moving && engine.isTextureReady) {
+            std::unique_lock lock(wakeup.mutex);
+            const auto published = [&] { return views.pending(); };
+            if (view.simulate) {
+                const std::chrono::duration<double> untilStep(simulation.secondsToNextStep());
+                wakeup.cv.wait_for(lock, untilStep, published);
+            } else {
+                wakeup.cv.wait(lock, published);
+                sfClock.restart(); // paused time is not simulated
+            }
+            continue;
+        }
+        redraw = false;
+
+        FrameProfiler::Sample timings;
+        if (view.useBudget && profiler.latest(timings)) {
+            const float computeMs = std::max(timings.cpuMs[FrameProfiler::Compute], timings.gpuMs[FrameProfiler::Compute]);
+            if (budget.update(timings.frame, computeMs))
+                engine.computeSize = budget.size(view.windowSize);
+        }
+
+        draw(engine, view.camera, view.windowSize, scene.objects, scene.hole, profiler);
+        if (view.showTimings && ++drawnFrames % 30 == 0) {
+            titles.back() = std::string(windowTitle) + " | " + profiler.summary();
+            titles.publish();
+        }
     }
+    engine.window->setActive(false);
 }
 
-void draw(Engine& engine, const Camera& camera, const std::vector<ObjectData>& objects, const BlackHole& hole) {
+void draw(Engine& engine, const Camera& camera, sf::Vector2u windowSize, const std::vector<ObjectData>& objects,
+          const BlackHole& hole, FrameProfiler& profiler) {
+    profiler.beginFrame();
+    engine.windowSize = windowSize;
+
     // --- Clear ---
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glViewport(0, 0, (int)engine.window->getSize().x, (int)engine.window->getSize().y);
+    glViewport(0, 0, (int)windowSize.x, (int)windowSize.y);
 
     // --- Grid ---
-    engine.generateGrid(objects);
-    engine.drawGrid(camera);
+    {
+        FrameProfiler::Scope timer(profiler, FrameProfiler::GenerateGrid);
+        engine.generateGrid(objects);
+    }
+    {
+        FrameProfiler::Scope timer(profiler, FrameProfiler::DrawGrid);
+        engine.drawGrid(camera);
+    }
 
     // --- Compute Raytracer -> Texture ---
-    engine.dispatchCompute(camera, hole, objects);
-    engine.drawFullScreenQuad();
+    {
+        FrameProfiler::Scope timer(profiler, FrameProfiler::Compute);
+        engine.dispatchCompute(camera, hole, objects);
+    }
+    {
+        FrameProfiler::Scope timer(profiler, FrameProfiler::Blit);
+        engine.drawFullScreenQuad();
+    }
 
     // --- Present ---
+    FrameProfiler::Scope timer(profiler, FrameProfiler::Display);
     engine.window->display();
 }
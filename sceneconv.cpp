@@ -0,0 +1,19 @@
+// Scene converter, see Scene.h for both formats.
+//   BlackHoleSceneConv <in> <out.bhsc>
+// The input may be text or binary; the output is always the current binary version.
+
+#include <cstdlib>
+#include <iostream>
+
+#include "Scene.h"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: BlackHoleSceneConv <in> <out.bhsc>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const Scene scene = Scene::load(argv[1]);
+    scene.saveBinary(argv[2]);
+    std::cout << argv[2] << ": " << scene.objects.size() << " objects" << std::endl;
+    return 0;
+}
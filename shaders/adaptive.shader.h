@@ -0,0 +1,68 @@
+#ifndef BLACKHOLESFML_ADAPTIVE_SHADER_H
+#define BLACKHOLESFML_ADAPTIVE_SHADER_H
+
+// Middle pass of adaptive sampling. The tracing kernel first fills a coarse grid,
+// one sample per STRIDE x STRIDE block. One workgroup looks at the coarse samples of
+// its 16x16 tile and the next row and column. If they disagree on the hit class,
+// or the colours spread more than refineThreshold, the tile goes into RefineTiles
+// and is traced at full resolution by an indirect dispatch. Otherwise it is
+// bilinearly filled from the coarse samples.
+inline auto classifyComp = R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) uniform image2D outImage;
+layout(binding = 2, r32ui) readonly uniform uimage2D hitImage;
+layout(std430, binding = 4) buffer RefineTiles {
+    uint dispatchX, dispatchY, dispatchZ;
+    uint tiles[];
+};
+
+uniform ivec2 texSize;
+uniform float refineThreshold;
+
+const int STRIDE = 4;
+const int SAMPLES = 16 / STRIDE; // coarse samples per tile side
+
+ivec2 coarse(ivec2 g) {
+    return min(g * STRIDE, ((texSize - 1) / STRIDE) * STRIDE);
+}
+
+void main() {
+    ivec2 tile = ivec2(gl_WorkGroupID.xy);
+    ivec2 g0 = tile * SAMPLES;
+
+    uint firstHit = imageLoad(hitImage, coarse(g0)).r;
+    bool mixed = false;
+    vec4 lo = vec4(1.0), hi = vec4(0.0);
+    for (int j = 0; j <= SAMPLES; ++j) {
+        for (int i = 0; i <= SAMPLES; ++i) {
+            ivec2 p = coarse(g0 + ivec2(i, j));
+            mixed = mixed || imageLoad(hitImage, p).r != firstHit;
+            vec4 c = imageLoad(outImage, p);
+            lo = min(lo, c);
+            hi = max(hi, c);
+        }
+    }
+
+    if (mixed || any(greaterThan(hi - lo, vec4(refineThreshold)))) {
+        if (gl_LocalInvocationIndex == 0u)
+            tiles[atomicAdd(dispatchX, 1u)] = uint(tile.x) | (uint(tile.y) << 16);
+        return;
+    }
+
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    if (pix.x >= texSize.x || pix.y >= texSize.y) return;
+    if (all(equal(pix % STRIDE, ivec2(0)))) return; // a coarse sample itself
+
+    ivec2 g = pix / STRIDE;
+    vec2 f = vec2(pix % STRIDE) / float(STRIDE);
+    vec4 c00 = imageLoad(outImage, coarse(g));
+    vec4 c10 = imageLoad(outImage, coarse(g + ivec2(1, 0)));
+    vec4 c01 = imageLoad(outImage, coarse(g + ivec2(0, 1)));
+    vec4 c11 = imageLoad(outImage, coarse(g + ivec2(1, 1)));
+    imageStore(outImage, pix, mix(mix(c00, c10, f.x), mix(c01, c11, f.x), f.y));
+}
+)";
+
+#endif //BLACKHOLESFML_ADAPTIVE_SHADER_H
@@ -14,56 +14,137 @@ void main() {
 }
 )";
 
-inline auto blitFraq = R"(
+// One direction of a separable Gaussian over the traced image, drawn at its own
+// resolution (the viewport is the traced part). Neighbouring taps are paired into
+// one bilinear fetch, so a radius of r costs about r + 1 fetches.
+inline auto blurFraq = R"(
 #version 330 core
 
-in vec2 TexCoord;
 out vec4 FragColor;
 
 uniform sampler2D u_texture;
-uniform vec2 u_textureSize;
-uniform float u_sigma;      // для Gaussian
-uniform float u_sharpness;  // коэффициент USM, например 0.4
+uniform vec2 u_textureSize; // traced part of the texture, from texel 0
+uniform vec2 u_storageSize; // whole texture, see TexturePool
+uniform vec2 u_direction;   // (1, 0) or (0, 1)
+uniform float u_sigma;      // in texels
 
-float gaussian(float x, float sigma) {
-    return exp(-(x*x)/(2.0*sigma*sigma));
+vec4 fetch(vec2 texel) {
+    return texture(u_texture, clamp(texel, vec2(0.5), u_textureSize - 0.5) / u_storageSize);
 }
 
-vec4 ewaGaussian(vec2 texCoord) {
-    vec2 coord = texCoord * u_textureSize;
-    vec4 color = vec4(0.0);
-    float totalWeight = 0.0;
-
-    int r = int(ceil(3.0*u_sigma));
-    for (int j = -r; j <= r; j++) {
-        for (int i = -r; i <= r; i++) {
-            vec2 sampleCoord = floor(coord) + vec2(i, j);
-            vec2 tCoord = sampleCoord / u_textureSize;
-            vec4 sample = texture(u_texture, tCoord);
+float gaussian(float x) {
+    return exp(-(x*x)/(2.0*u_sigma*u_sigma));
+}
 
-            float d = length(coord - sampleCoord);
-            float w = gaussian(d, u_sigma);
+void main() {
+    vec2 coord = gl_FragCoord.xy;
+    vec4 color = fetch(coord);
+    float totalWeight = 1.0;
 
-            color += sample * w;
-            totalWeight += w;
-        }
+    int r = int(ceil(3.0*u_sigma));
+    for (int i = 1; i <= r; i += 2) {
+        float w0 = gaussian(float(i)), w1 = gaussian(float(i + 1));
+        float w = w0 + w1;
+        float offset = (float(i)*w0 + float(i + 1)*w1) / w;
+        color += (fetch(coord + u_direction*offset) + fetch(coord - u_direction*offset)) * w;
+        totalWeight += 2.0*w;
     }
-    return color / totalWeight;
+    FragColor = color / totalWeight;
 }
+)";
+
+// Edge-directed upscaling in the spirit of FSR's EASU. Twelve texels around the
+// output position give a luma gradient; the reconstruction kernel, a windowed
+// Lanczos-2 approximation, is stretched along the edge and narrowed across it in
+// proportion to how sharp the edge is, then clamped to the nearest 2x2 texels to
+// avoid ringing. The blurred image (blurFraq) serves as the unsharp mask.
+inline auto blitFraq = R"(
+#version 330 core
+
+in vec2 TexCoord;
+out vec4 FragColor;
+
+uniform sampler2D u_texture;
+uniform sampler2D u_blurred;  // same layout as u_texture
+uniform vec2 u_textureSize;   // traced part of the texture, from texel 0
+uniform vec2 u_storageSize;   // whole texture, see TexturePool
+uniform float u_sharpness;    // unsharp mask amount
 
-void main()
-{
-    vec4 blurred = ewaGaussian(TexCoord);
-    vec4 original = texture(u_texture, TexCoord); // bilinear оригинал
+vec4 texelAt(vec2 texel) {
+    return texelFetch(u_texture, ivec2(clamp(texel, vec2(0.0), u_textureSize - 1.0)), 0);
+}
 
-    // маска резкости
-    vec4 mask = original - blurred;
+float luma(vec4 c) {
+    return c.g + 0.5*(c.r + c.b);
+}
 
-    // финальный результат с лёгкой резкостью
-    FragColor = blurred + u_sharpness * mask;
+float easuWeight(vec2 offset, vec2 dir, vec2 len, float lobe, float clip) {
+    vec2 v = vec2(dot(offset, dir), dot(offset, vec2(-dir.y, dir.x))) * len;
+    float d2 = min(dot(v, v), clip);
+    float wB = 2.0/5.0*d2 - 1.0;
+    float wA = lobe*d2 - 1.0;
+    wB *= wB;
+    wA *= wA;
+    wB = 25.0/16.0*wB - (25.0/16.0 - 1.0);
+    return wB * wA;
 }
 
+void main() {
+    vec2 p = TexCoord * u_textureSize - 0.5; // texel centres at integers
+    vec2 base = floor(p);
+    vec2 f = p - base;
+
+    // 4x4 around p without the corners, t[x][y] is texel base + (x - 1, y - 1)
+    vec4 t[16];
+    float l[16];
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            int k = y*4 + x;
+            if ((x == 0 || x == 3) && (y == 0 || y == 3)) continue;
+            t[k] = texelAt(base + vec2(x - 1, y - 1));
+            l[k] = luma(t[k]);
+        }
+    }
+
+    // central-difference gradients of the inner 2x2, blended bilinearly
+    vec2 g00 = vec2(l[6] - l[4],  l[9] - l[1]);
+    vec2 g10 = vec2(l[7] - l[5],  l[10] - l[2]);
+    vec2 g01 = vec2(l[10] - l[8], l[13] - l[5]);
+    vec2 g11 = vec2(l[11] - l[9], l[14] - l[6]);
+    vec2 dir = mix(mix(g00, g10, f.x), mix(g01, g11, f.x), f.y);
+    float lo = min(min(l[5], l[6]), min(l[9], l[10]));
+    float hi = max(max(l[5], l[6]), max(l[9], l[10]));
+    float dirLength = length(dir);
+    float edge = clamp(dirLength / (2.0*(hi - lo) + 1.0/255.0), 0.0, 1.0);
+    edge *= edge;
+    dir = dirLength > 1e-5 ? dir / dirLength : vec2(1.0, 0.0);
+
+    // diagonal edges get the kernel stretched to the square's diagonal
+    float stretch = 1.0 / max(abs(dir.x), abs(dir.y));
+    vec2 len = vec2(1.0 + (stretch - 1.0)*edge, 1.0 - 0.5*edge);
+    float lobe = 0.5 + (1.0/4.0 - 0.04 - 0.5)*edge;
+    float clip = 1.0 / lobe;
 
+    vec4 color = vec4(0.0);
+    float totalWeight = 0.0;
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            if ((x == 0 || x == 3) && (y == 0 || y == 3)) continue;
+            int k = y*4 + x;
+            float w = easuWeight(vec2(x - 1, y - 1) - f, dir, len, lobe, clip);
+            color += t[k] * w;
+            totalWeight += w;
+        }
+    }
+    color /= totalWeight;
+    vec4 cmin = min(min(t[5], t[6]), min(t[9], t[10]));
+    vec4 cmax = max(max(t[5], t[6]), max(t[9], t[10]));
+    color = clamp(color, cmin, cmax);
+
+    vec2 uv = clamp(TexCoord * u_textureSize, vec2(0.5), u_textureSize - 0.5) / u_storageSize;
+    vec4 blurred = texture(u_blurred, uv);
+    FragColor = color + u_sharpness * (color - blurred);
+}
 )";
 
 #endif
@@ -0,0 +1,164 @@
+#ifndef BLACKHOLESFML_DEFLECTION_SHADER_H
+#define BLACKHOLESFML_DEFLECTION_SHADER_H
+
+// Same output as geodesicComp, but every ray follows a precomputed r(psi) path
+// from DeflectionTable (see DeflectionTable.h) instead of being integrated.
+inline auto deflectionComp = R"(
+#version 430
+#ifndef SCHWARZSCHILD_RADIUS
+#define SCHWARZSCHILD_RADIUS 1.269e10 // Engine::deflectionTracer sets the scene's
+#endif
+#ifndef DISK
+#define DISK 1
+#endif
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) writeonly uniform image2D outImage;
+layout(binding = 2, r32ui) writeonly uniform uimage2D hitImage; // 0 escape, 1 hole, 2 disk, 3 + object index
+layout(std430, binding = 4) readonly buffer RefineTiles {
+    uint dispatchX, dispatchY, dispatchZ;
+    uint tiles[]; // x | y << 16, filled by classifyComp
+};
+layout(std140, binding = 1) uniform Camera {
+    vec3 camPos;     float _pad0;
+    vec3 camRight;   float _pad1;
+    vec3 camUp;      float _pad2;
+    vec3 camForward; float _pad3;
+    float tanHalfFov;
+    bool moving;
+    float aspect;
+    int   _pad4;
+} cam;
+
+layout(std140, binding = 2) uniform Disk {
+    float disk_r1;
+    float disk_r2;
+    float disk_num;
+    float thickness;
+};
+
+struct Object { // ObjectData
+    vec4 posRadius;
+    vec4 color;
+    float mass;
+    float velocity[3];
+};
+
+layout(std430, binding = 3) readonly buffer Objects {
+    int numObjects;
+    float objectsOuter; // farthest any object reaches from the hole
+    int _pad6, _pad7;
+    Object objects[];
+};
+
+layout(std430, binding = 5) readonly buffer ObjectShells {
+    float shellBase;      // see ObjectShells.h
+    float shellInvLog;
+    uvec2 shellRanges[64]; // first, count
+    uint shellObjects[];   // object indices grouped by shell
+};
+
+layout(binding = 1) uniform sampler2D orbitRadius; // r(psi), one row per launch angle
+layout(binding = 2) uniform sampler2D orbitEnd;    // per row: psiEnd, captured, deflection
+
+uniform ivec2 texSize;
+uniform float psiMax;
+uniform ivec2 sampleOffset; // this frame's pixel inside every sampleStride block
+uniform int sampleStride;
+uniform bool refineTiles; // trace whole 16x16 tiles listed in RefineTiles instead
+
+const float PI = 3.14159265;
+const float SagA_rs = SCHWARZSCHILD_RADIUS;
+
+// objects a ray at r may touch within one step, first and count in shellObjects
+uvec2 shellRange(float r) {
+    int s = clamp(int(floor(log(max(r / shellBase, 1e-3)) * shellInvLog)) + 1, 0, 63);
+    return shellRanges[s];
+}
+
+int shellObject(uint k) {
+    return int(shellObjects[k]);
+}
+
+void main() {
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy) * sampleStride + sampleOffset;
+    if (refineTiles) {
+        uint tile = tiles[gl_WorkGroupID.x];
+        pix = ivec2(tile & 0xFFFFu, tile >> 16) * 16 + ivec2(gl_LocalInvocationID.xy);
+    }
+    if (pix.x >= texSize.x || pix.y >= texSize.y) return;
+
+    float u = (2.0 * (pix.x + 0.5) / texSize.x - 1.0) * cam.aspect * cam.tanHalfFov;
+    float v = (1.0 - 2.0 * (pix.y + 0.5) / texSize.y) * cam.tanHalfFov;
+    vec3 dir = normalize(u * cam.camRight - v * cam.camUp + cam.camForward);
+
+    // Orbital plane: outward radial e_r and the in-plane tangent e_t
+    float r0 = length(cam.camPos);
+    vec3 er = cam.camPos / r0;
+    float cosAlpha = clamp(dot(dir, er), -1.0, 1.0);
+    vec3 tangent = dir - cosAlpha * er;
+    vec3 et = length(tangent) > 1e-6 ? normalize(tangent)
+                                     : normalize(cross(er, abs(er.y) < 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0)));
+    float alpha = acos(cosAlpha);
+
+    ivec2 tableSize = textureSize(orbitRadius, 0);
+    float row = (alpha / PI * float(tableSize.y - 1) + 0.5) / float(tableSize.y);
+    vec4 end = textureLod(orbitEnd, vec2(row, 0.5), 0.0);
+    float psiEnd = end.x;
+    bool captured = end.y > 0.5;
+
+    vec4 color = vec4(0.0);
+    uint hitClass = 0u;
+    bool hit = false;
+    vec3 prevPos = cam.camPos;
+    int n = int(ceil(psiEnd / psiMax * float(tableSize.x - 1)));
+    for (int j = 1; j <= n && !hit; ++j) {
+        float psi = min(psiMax * float(j) / float(tableSize.x - 1), psiEnd);
+        float column = (psi / psiMax * float(tableSize.x - 1) + 0.5) / float(tableSize.x);
+        float r = textureLod(orbitRadius, vec2(column, row), 0.0).r;
+        // rows blended across the capture boundary can dip inside the horizon
+        if (r <= SagA_rs) { captured = true; break; }
+        vec3 P = r * (cos(psi) * er + sin(psi) * et);
+
+        if (DISK != 0 && prevPos.y * P.y < 0.0) {
+            vec3 diskPos = mix(prevPos, P, prevPos.y / (prevPos.y - P.y));
+            float rho = length(diskPos.xz);
+            if (rho >= disk_r1 && rho <= disk_r2) {
+                float rd = length(diskPos) / disk_r2;
+                color = vec4(1.0, rd, 0.2, rd);
+                hitClass = 2u;
+                hit = true;
+                break;
+            }
+        }
+
+        uvec2 range = shellRange(r);
+        for (uint k = range.x; k < range.x + range.y; ++k) {
+            int i = shellObject(k);
+            vec3 center = objects[i].posRadius.xyz;
+            if (distance(P, center) <= objects[i].posRadius.w) {
+                vec3 N = normalize(P - center);
+                vec3 V = normalize(cam.camPos - P);
+                float ambient = 0.1;
+                float diff = max(dot(N, V), 0.0);
+                float intensity = ambient + (1.0 - ambient) * diff;
+                color = vec4(objects[i].color.rgb * intensity, objects[i].color.a);
+                hitClass = 3u + uint(i);
+                hit = true;
+                break;
+            }
+        }
+        prevPos = P;
+    }
+
+    if (!hit && captured) {
+        color = vec4(0.0, 0.0, 0.0, 1.0);
+        hitClass = 1u;
+    }
+
+    imageStore(outImage, pix, color);
+    imageStore(hitImage, pix, uvec4(hitClass));
+}
+)";
+
+#endif //BLACKHOLESFML_DEFLECTION_SHADER_H
@@ -3,9 +3,44 @@
 
 inline auto geodesicComp = R"(
 #version 430
-layout(local_size_x = 16, local_size_y = 16) in;
+// Engine::tracerProgram compiles one permutation per set of these, the defaults
+// below are the general case
+#ifndef LOCAL_SIZE
+#define LOCAL_SIZE 16     // 8 or 16, refined tiles stay 16x16
+#endif
+#ifndef MAX_STEPS
+#define MAX_STEPS 60000
+#endif
+#ifndef MAX_OBJECTS
+#define MAX_OBJECTS 1048576 // bound on numObjects, 0 drops the object tests
+#endif
+#ifndef DISK
+#define DISK 1
+#endif
+#ifndef PLANAR
+#define PLANAR 0          // 1: orbit equation in the ray's plane, see tracePlanar
+#endif
+#ifndef SCHWARZSCHILD_RADIUS
+#define SCHWARZSCHILD_RADIUS 1.269e10
+#endif
+#ifndef WAVEFRONT
+#define WAVEFRONT 0       // 1: step chunks over a compacted ray list, see Engine::traceWavefront
+#endif
+#if WAVEFRONT && PLANAR
+#error the wavefront passes only carry the 3D geodesic state
+#endif
+#if WAVEFRONT
+layout(local_size_x = LOCAL_SIZE * LOCAL_SIZE) in;
+#else
+layout(local_size_x = LOCAL_SIZE, local_size_y = LOCAL_SIZE) in;
+#endif
 
 layout(binding = 0, rgba8) writeonly uniform image2D outImage;
+layout(binding = 2, r32ui) writeonly uniform uimage2D hitImage; // 0 escape, 1 hole, 2 disk, 3 + object index
+layout(std430, binding = 4) readonly buffer RefineTiles {
+    uint dispatchX, dispatchY, dispatchZ;
+    uint tiles[]; // x | y << 16, filled by classifyComp
+};
 layout(std140, binding = 1) uniform Camera {
     vec3 camPos;     float _pad0;
     vec3 camRight;   float _pad1;
@@ -24,22 +59,69 @@ layout(std140, binding = 2) uniform Disk {
     float thickness;
 };
 
-layout(std140, binding = 3) uniform Objects {
+struct Object { // ObjectData
+    vec4 posRadius;
+    vec4 color;
+    float mass;
+    float velocity[3];
+};
+
+layout(std430, binding = 3) readonly buffer Objects {
     int numObjects;
-    vec4 objPosRadius[16];
-    vec4 objColor[16];
-    float  mass[16];
+    float objectsOuter; // farthest any object reaches from the hole
+    int _pad6, _pad7;
+    Object objects[];
+};
+
+layout(std430, binding = 5) readonly buffer ObjectShells {
+    float shellBase;      // see ObjectShells.h
+    float shellInvLog;
+    uvec2 shellRanges[64]; // first, count
+    uint shellObjects[];   // object indices grouped by shell
 };
 
 uniform ivec2 texSize;
+uniform float tolerance; // local error bound of the adaptive integrator
+uniform ivec2 sampleOffset; // this frame's pixel inside every sampleStride block
+uniform int sampleStride;
+uniform ivec2 tileOrigin;   // first sampled pixel of this dispatch, see TileScheduler
+uniform bool refineTiles; // trace whole 16x16 tiles listed in RefineTiles instead
 
-const float SagA_rs = 1.269e10;
-const float D_LAMBDA = 1e7;
-const double ESCAPE_R = 1e30;
+#if WAVEFRONT
+struct WaveRay { // a ray between two passes
+    vec4 q;       // r, theta, phi, E
+    vec4 v;       // dr, dtheta, dphi, next step
+    float lambda;
+    int steps;
+    uint pix;     // x | y << 16
+    uint _pad;
+};
+
+layout(std430, binding = 6) buffer WaveRays {
+    WaveRay waveRays[];
+};
+
+// two lists of rays still going, each with its indirect dispatch args
+layout(std430, binding = 7) buffer WaveLists {
+    uvec4 waveHeader[2]; // groups x, 1, 1, count
+    uint waveList[];     // list l starts at l * waveListStride
+};
+
+uniform bool waveInit;       // first pass: one new ray per sampled pixel
+uniform uint waveParity;     // list this pass reads, it appends to the other one
+uniform uint waveListStride;
+uniform int waveSteps;       // steps of this pass
+#endif
+
+const float SagA_rs = SCHWARZSCHILD_RADIUS;
+const float D_LAMBDA = 1e7;      // old fixed step, only sets how far a ray may travel now
+const float MAX_STEP = 0.1;      // step limits as fractions of r
+const float MIN_STEP = 1e-5;
 
 // Globals to store hit info
 vec4 objectColor = vec4(0.0);
 vec3 hitCenter = vec3(0.0);
+int hitIndex = -1;
 float hitRadius = 0.0;
 
 struct Ray {
@@ -72,27 +154,48 @@ bool intercept(Ray ray, float rs) {
     return ray.r <= rs;
 }
 
+// objects a ray at r may touch within one step, first and count in shellObjects
+uvec2 shellRange(float r) {
+    int s = clamp(int(floor(log(max(r / shellBase, 1e-3)) * shellInvLog)) + 1, 0, 63);
+    return shellRanges[s];
+}
+
+int shellObject(uint k) {
+    return int(shellObjects[k]);
+}
+
 // Returns true on hit, captures center, radius, and base color
-bool interceptObject(Ray ray) {
-    vec3 P = vec3(ray.x, ray.y, ray.z);
-    for (int i = 0; i < numObjects; ++i) {
-        vec3 center = objPosRadius[i].xyz;
-        float radius = objPosRadius[i].w;
+bool interceptObjectAt(vec3 P, float r) {
+#if MAX_OBJECTS > 0
+    uvec2 range = shellRange(r);
+    uint first = range.x, count = range.y;
+    for (uint j = 0u; j < uint(MAX_OBJECTS); ++j) {
+        if (j >= count) break;
+        int i = shellObject(first + j);
+        vec3 center = objects[i].posRadius.xyz;
+        float radius = objects[i].posRadius.w;
         if (distance(P, center) <= radius) {
-            objectColor = objColor[i];
+            objectColor = objects[i].color;
             hitCenter = center;
+            hitIndex = i;
             hitRadius = radius;
             return true;
         }
     }
+#endif
     return false;
 }
 
-void geodesicRHS(Ray ray, out vec3 d1, out vec3 d2) {
-    float r = ray.r, theta = ray.theta;
-    float dr = ray.dr, dtheta = ray.dtheta, dphi = ray.dphi;
+bool interceptObject(Ray ray) {
+    return interceptObjectAt(vec3(ray.x, ray.y, ray.z), ray.r);
+}
+
+// q = (r, theta, phi), v = (dr, dtheta, dphi)
+void geodesicRHS(vec3 q, vec3 v, float E, out vec3 d1, out vec3 d2) {
+    float r = q.x, theta = q.y;
+    float dr = v.x, dtheta = v.y, dphi = v.z;
     float f = 1.0 - SagA_rs / r;
-    float dt_dL = ray.E / f;
+    float dt_dL = E / f;
 
     d1 = vec3(dr, dtheta, dphi);
     d2.x = - (SagA_rs / (2.0 * r*r)) * f * dt_dL * dt_dL
@@ -102,69 +205,214 @@ void geodesicRHS(Ray ray, out vec3 d1, out vec3 d2) {
     d2.z = -2.0*dr*dphi/r - 2.0*cos(theta)/(sin(theta)) * dtheta * dphi;
 }
 
-void rk4Step(inout Ray ray, float dL) {
-    vec3 k1a, k1b;
-    geodesicRHS(ray, k1a, k1b);
+// Next step over this one from the error relative to tolerance: 0.9 err^-1/5 for the
+// O(h^5) estimate, as err^-51/256 from square roots like geodesic::nextStep
+float stepFactor(float err) {
+    float e4 = sqrt(sqrt(max(err, 1e-10)));
+    float e16 = sqrt(sqrt(e4));
+    float e64 = sqrt(sqrt(e16));
+    float e256 = sqrt(sqrt(e64));
+    return clamp(0.9 * e16 * e256 / (e4 * e64), 0.2, 5.0);
+}
+
+// Dormand-Prince 5(4). Advances the ray by dL when the embedded error estimate
+// is within tolerance and always returns the step size to try next.
+bool rk45Step(inout Ray ray, float dL, out float dLNext) {
+    vec3 q = vec3(ray.r, ray.theta, ray.phi);
+    vec3 v = vec3(ray.dr, ray.dtheta, ray.dphi);
+    vec3 k1q, k1v, k2q, k2v, k3q, k3v, k4q, k4v, k5q, k5v, k6q, k6v, k7q, k7v;
+
+    geodesicRHS(q, v, ray.E, k1q, k1v);
+    geodesicRHS(q + dL*(1.0/5.0)*k1q,
+                v + dL*(1.0/5.0)*k1v, ray.E, k2q, k2v);
+    geodesicRHS(q + dL*(3.0/40.0*k1q + 9.0/40.0*k2q),
+                v + dL*(3.0/40.0*k1v + 9.0/40.0*k2v), ray.E, k3q, k3v);
+    geodesicRHS(q + dL*(44.0/45.0*k1q - 56.0/15.0*k2q + 32.0/9.0*k3q),
+                v + dL*(44.0/45.0*k1v - 56.0/15.0*k2v + 32.0/9.0*k3v), ray.E, k4q, k4v);
+    geodesicRHS(q + dL*(19372.0/6561.0*k1q - 25360.0/2187.0*k2q + 64448.0/6561.0*k3q - 212.0/729.0*k4q),
+                v + dL*(19372.0/6561.0*k1v - 25360.0/2187.0*k2v + 64448.0/6561.0*k3v - 212.0/729.0*k4v), ray.E, k5q, k5v);
+    geodesicRHS(q + dL*(9017.0/3168.0*k1q - 355.0/33.0*k2q + 46732.0/5247.0*k3q + 49.0/176.0*k4q - 5103.0/18656.0*k5q),
+                v + dL*(9017.0/3168.0*k1v - 355.0/33.0*k2v + 46732.0/5247.0*k3v + 49.0/176.0*k4v - 5103.0/18656.0*k5v), ray.E, k6q, k6v);
+    vec3 q5 = q + dL*(35.0/384.0*k1q + 500.0/1113.0*k3q + 125.0/192.0*k4q - 2187.0/6784.0*k5q + 11.0/84.0*k6q);
+    vec3 v5 = v + dL*(35.0/384.0*k1v + 500.0/1113.0*k3v + 125.0/192.0*k4v - 2187.0/6784.0*k5v + 11.0/84.0*k6v);
+    geodesicRHS(q5, v5, ray.E, k7q, k7v);
+
+    vec3 eq = dL*(71.0/57600.0*k1q - 71.0/16695.0*k3q + 71.0/1920.0*k4q - 17253.0/339200.0*k5q + 22.0/525.0*k6q - 1.0/40.0*k7q);
+    vec3 ev = dL*(71.0/57600.0*k1v - 71.0/16695.0*k3v + 71.0/1920.0*k4v - 17253.0/339200.0*k5v + 22.0/525.0*k6v - 1.0/40.0*k7v);
 
-    ray.r      += dL * k1a.x;
-    ray.theta  += dL * k1a.y;
-    ray.phi    += dL * k1a.z;
-    ray.dr     += dL * k1b.x;
-    ray.dtheta += dL * k1b.y;
-    ray.dphi   += dL * k1b.z;
+    // every component as a relative position/direction error
+    float err = max(abs(eq.x) / q.x, abs(ev.x));
+    err = max(err, max(abs(eq.y), abs(eq.z)));
+    err = max(err, max(abs(ev.y), abs(ev.z)) * q.x);
+    err /= tolerance;
+
+    dLNext = dL * stepFactor(err);
+    if (err > 1.0 && dL > MIN_STEP * ray.r) return false;
+
+    ray.r = q5.x; ray.theta = q5.y; ray.phi = q5.z;
+    ray.dr = v5.x; ray.dtheta = v5.y; ray.dphi = v5.z;
 
     ray.x = ray.r * sin(ray.theta) * cos(ray.phi);
     ray.y = ray.r * sin(ray.theta) * sin(ray.phi);
     ray.z = ray.r * cos(ray.theta);
+    return true;
 }
 
-bool crossesEquatorialPlane(vec3 oldPos, vec3 newPos) {
-    bool crossed = (oldPos.y * newPos.y < 0.0);
-    float r = length(vec2(newPos.x, newPos.z));
-    return crossed && (r >= disk_r1 && r <= disk_r2);
+// Largest step allowed here: a fraction of r, no deeper than a fifth of an
+// object's radius past its surface, no thicker than the disk slab over the annulus.
+float stepLimitAt(vec3 P, float r) {
+    float hMax = MAX_STEP * r;
+#if MAX_OBJECTS > 0
+    uvec2 range = shellRange(r);
+    uint first = range.x, count = range.y;
+    for (uint j = 0u; j < uint(MAX_OBJECTS); ++j) {
+        if (j >= count) break;
+        int i = shellObject(first + j);
+        float radius = objects[i].posRadius.w;
+        hMax = min(hMax, max(distance(P, objects[i].posRadius.xyz) - radius, 0.2 * radius));
+    }
+#endif
+#if DISK
+    float rho = length(P.xz);
+    if (rho > 0.5 * disk_r1 && rho < 2.0 * disk_r2)
+        hMax = min(hMax, max(abs(P.y), thickness));
+#endif
+    return hMax;
 }
 
-void main() {
-    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
-    if (pix.x >= texSize.x || pix.y >= texSize.y) return;
+float stepLimit(Ray ray) {
+    return stepLimitAt(vec3(ray.x, ray.y, ray.z), ray.r);
+}
 
-    // Init Ray
-    float u = (2.0 * (pix.x + 0.5) / texSize.x - 1.0) * cam.aspect * cam.tanHalfFov;
-    float v = (1.0 - 2.0 * (pix.y + 0.5) / texSize.y) * cam.tanHalfFov;
-    vec3 dir = normalize(u * cam.camRight - v * cam.camUp + cam.camForward);
-    Ray ray = initRay(cam.camPos, dir);
+// The hit point is interpolated inside the step, so long steps still land on the right radius
+// Past this r an outgoing ray has nothing left to hit and never turns back (see
+// escapeRadius in FrameParams.h), so it counts as escaped.
+float escapeRadius() {
+    float r = max(1.5 * SagA_rs, objectsOuter);
+#if DISK
+    r = max(r, disk_r2);
+#endif
+    return r;
+}
 
-    vec4 color = vec4(0.0);
-    vec3 prevPos = vec3(ray.x, ray.y, ray.z);
+bool crossesEquatorialPlane(vec3 oldPos, vec3 newPos, out vec3 hitPos) {
+    hitPos = newPos;
+    if (DISK == 0) return false;
+    if (oldPos.y * newPos.y >= 0.0) return false;
+    hitPos = mix(oldPos, newPos, oldPos.y / (oldPos.y - newPos.y));
+    float r = length(hitPos.xz);
+    return r >= disk_r1 && r <= disk_r2;
+}
+
+// A Schwarzschild geodesic stays in the plane through the hole, the camera and the
+// initial direction. In that plane U = r_s / r against the angle phi obeys the
+// orbit equation U'' + U = 1.5 U^2: two components, no trigonometry and no pole at
+// theta = 0 as in geodesicRHS. y = (U, dU/dphi).
+vec2 binetRHS(vec2 y) {
+    return vec2(y.y, 1.5 * y.x * y.x - y.x);
+}
+
+// rk45Step for the orbit equation, dPhi in radians
+bool rk45Binet(inout vec2 y, float dPhi, float minStep, out float dPhiNext) {
+    vec2 k1 = binetRHS(y);
+    vec2 k2 = binetRHS(y + dPhi*(1.0/5.0*k1));
+    vec2 k3 = binetRHS(y + dPhi*(3.0/40.0*k1 + 9.0/40.0*k2));
+    vec2 k4 = binetRHS(y + dPhi*(44.0/45.0*k1 - 56.0/15.0*k2 + 32.0/9.0*k3));
+    vec2 k5 = binetRHS(y + dPhi*(19372.0/6561.0*k1 - 25360.0/2187.0*k2 + 64448.0/6561.0*k3 - 212.0/729.0*k4));
+    vec2 k6 = binetRHS(y + dPhi*(9017.0/3168.0*k1 - 355.0/33.0*k2 + 46732.0/5247.0*k3 + 49.0/176.0*k4 - 5103.0/18656.0*k5));
+    vec2 y5 = y + dPhi*(35.0/384.0*k1 + 500.0/1113.0*k3 + 125.0/192.0*k4 - 2187.0/6784.0*k5 + 11.0/84.0*k6);
+    vec2 k7 = binetRHS(y5);
+    vec2 e = dPhi*(71.0/57600.0*k1 - 71.0/16695.0*k3 + 71.0/1920.0*k4 - 17253.0/339200.0*k5 + 22.0/525.0*k6 - 1.0/40.0*k7);
+
+    // relative radius error, slope error against the larger of U and its slope
+    float err = max(abs(e.x) / y.x, abs(e.y) / max(y.x, abs(y.y))) / tolerance;
+    dPhiNext = dPhi * stepFactor(err);
+    if (err > 1.0 && dPhi > minStep) return false;
+    y = y5;
+    return true;
+}
+
+// Traces the ray in its orbital plane and maps every step back to 3D for the disk
+// and object tests. The step is the 3D length limit turned into an angle.
+// Returns 0 escape, 1 hole, 2 disk, 3 object; P is where the ray ended.
+int tracePlanar(vec3 pos, vec3 dir, out vec3 P) {
+    float r0 = length(pos);
+    vec3 e1 = pos / r0;
+    vec3 n = cross(e1, dir);
+    // e2 points along the tangential part of dir; a radial ray gets any perpendicular
+    vec3 e2 = length(n) > 1e-7 ? cross(normalize(n), e1)
+                               : normalize(cross(e1, abs(e1.y) < 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    float tangential = max(dot(dir, e2), 1e-7);
+    vec2 y = vec2(SagA_rs / r0, -SagA_rs / r0 * dot(dir, e1) / tangential);
+
+    P = pos;
+    vec3 prevPos = pos;
+    float phi = 0.0;
+    float dPhi = 0.01;
     float lambda = 0.0;
+    const float lambdaMax = float(MAX_STEPS) * D_LAMBDA;
+    const float escapeU = SagA_rs / escapeRadius();
+    for (int i = 0; i < MAX_STEPS && lambda < lambdaMax; ++i) {
+        if (y.x >= 1.0) return 1;
+        float r = SagA_rs / y.x;
+        float stretch = sqrt(1.0 + (y.y / y.x) * (y.y / y.x)); // path length per r dphi
+        float h = min(dPhi, stepLimitAt(P, r) / (r * stretch));
+        if (!rk45Binet(y, h, MIN_STEP / stretch, dPhi)) continue;
+        if (y.x <= 0.0) return 0; // reaches infinity inside this step
+        phi += h;
+
+        P = SagA_rs / y.x * (cos(phi) * e1 + sin(phi) * e2);
+        lambda += distance(P, prevPos);
+        vec3 diskPos;
+        if (crossesEquatorialPlane(prevPos, P, diskPos)) { P = diskPos; return 2; }
+        if (interceptObjectAt(P, SagA_rs / y.x)) return 3;
+        prevPos = P;
+        if (y.x < escapeU && y.y < 0.0) return 0; // U falling: r grows
+    }
+    return 0;
+}
 
-    bool hitBlackHole = false;
-    bool hitDisk      = false;
-    bool hitObject    = false;
+vec3 primaryDir(ivec2 pix) {
+    float u = (2.0 * (pix.x + 0.5) / texSize.x - 1.0) * cam.aspect * cam.tanHalfFov;
+    float v = (1.0 - 2.0 * (pix.y + 0.5) / texSize.y) * cam.tanHalfFov;
+    return normalize(u * cam.camRight - v * cam.camUp + cam.camForward);
+}
 
-    int steps = cam.moving ? 48000 : 60000;
-    for (int i = 0; i < steps; ++i) {
-        if (intercept(ray, SagA_rs)) { hitBlackHole = true; break; }
-        rk4Step(ray, D_LAMBDA);
-        lambda += D_LAMBDA;
+// The geodesic loop from step i up to stepEnd. Returns 0 escape, 1 hole, 2 disk,
+// 3 object, or -1 while the ray is still going at stepEnd; endPos is where it stopped.
+int integrate(inout Ray ray, inout float lambda, inout float dL, inout int i, int stepEnd, out vec3 endPos) {
+    const float lambdaMax = float(MAX_STEPS) * D_LAMBDA;
+    const float escapeR = escapeRadius();
+    vec3 prevPos = vec3(ray.x, ray.y, ray.z);
+    for (; i < stepEnd && lambda < lambdaMax; ++i) {
+        if (intercept(ray, SagA_rs)) { endPos = prevPos; return 1; }
+        float h = min(dL, stepLimit(ray));
+        if (!rk45Step(ray, h, dL)) continue;
+        lambda += h;
 
         vec3 newPos = vec3(ray.x, ray.y, ray.z);
-        if (crossesEquatorialPlane(prevPos, newPos)) { hitDisk = true; break; }
-        if (interceptObject(ray)) { hitObject = true; break; }
+        if (crossesEquatorialPlane(prevPos, newPos, endPos)) return 2;
+        endPos = newPos;
+        if (interceptObject(ray)) return 3;
         prevPos = newPos;
-        if (ray.r > ESCAPE_R) break;
+        if (ray.r > escapeR && ray.dr > 0.0) return 0;
     }
+    endPos = prevPos;
+    return i < MAX_STEPS && lambda < lambdaMax ? -1 : 0;
+}
 
-    if (hitDisk) {
-        double r = length(vec3(ray.x, ray.y, ray.z)) / disk_r2;
+void writePixel(ivec2 pix, int hit, vec3 endPos) {
+    vec4 color = vec4(0.0);
+    if (hit == 2) {
+        double r = length(endPos) / disk_r2;
         vec3 diskColor = vec3(1.0, r, 0.2);
         //r = 1.0 - abs(r - 0.5) * 2.0;
         color = vec4(diskColor, r);
-    } else if (hitBlackHole) {
+    } else if (hit == 1) {
         color = vec4(0.0, 0.0, 0.0, 1.0);
-    } else if (hitObject) {
+    } else if (hit == 3) {
         // Compute shading
-        vec3 P = vec3(ray.x, ray.y, ray.z);
+        vec3 P = endPos;
         vec3 N = normalize(P - hitCenter);
         vec3 V = normalize(cam.camPos - P);
         float ambient = 0.1;
@@ -172,11 +420,102 @@ void main() {
         float intensity = ambient + (1.0 - ambient) * diff;
         vec3 shaded = objectColor.rgb * intensity;
         color = vec4(shaded, objectColor.a);
-    } else {
-        color = vec4(0.0);
     }
 
+    uint hitClass = hit == 3 ? 3u + uint(hitIndex) : uint(hit);
     imageStore(outImage, pix, color);
+    imageStore(hitImage, pix, uvec4(hitClass));
+}
+
+void trace(ivec2 pix) {
+    if (pix.x >= texSize.x || pix.y >= texSize.y) return;
+
+    vec3 dir = primaryDir(pix);
+    vec3 endPos; // on the disk for a disk hit
+#if PLANAR
+    int hit = tracePlanar(cam.camPos, dir, endPos);
+#else
+    Ray ray = initRay(cam.camPos, dir);
+    float lambda = 0.0;
+    float dL = 0.01 * ray.r;
+    int i = 0;
+    int hit = integrate(ray, lambda, dL, i, MAX_STEPS, endPos);
+#endif
+    writePixel(pix, hit, endPos);
+}
+
+#if WAVEFRONT
+// One pass: every ray of the input list (or of the sampled pixels on the first pass)
+// takes up to waveSteps steps. Finished rays write their pixel, the others are saved
+// and appended to the output list; whoever opens a new workgroup's worth of the list
+// adds that group to its dispatch args.
+void advanceWave() {
+    uint index = gl_GlobalInvocationID.x;
+    uint slot;
+    ivec2 pix;
+    Ray ray;
+    float lambda, dL;
+    int i;
+    if (waveInit) {
+        ivec2 samples = (texSize - sampleOffset + sampleStride - 1) / sampleStride;
+        if (index >= uint(samples.x * samples.y)) return;
+        slot = index;
+        pix = ivec2(int(index) % samples.x, int(index) / samples.x) * sampleStride + sampleOffset;
+        ray = initRay(cam.camPos, primaryDir(pix));
+        lambda = 0.0;
+        dL = 0.01 * ray.r;
+        i = 0;
+    } else {
+        if (index >= waveHeader[waveParity].w) return;
+        slot = waveList[waveParity * waveListStride + index];
+        WaveRay saved = waveRays[slot];
+        pix = ivec2(saved.pix & 0xFFFFu, saved.pix >> 16);
+        ray.r = saved.q.x; ray.theta = saved.q.y; ray.phi = saved.q.z; ray.E = saved.q.w;
+        ray.dr = saved.v.x; ray.dtheta = saved.v.y; ray.dphi = saved.v.z;
+        ray.x = ray.r * sin(ray.theta) * cos(ray.phi);
+        ray.y = ray.r * sin(ray.theta) * sin(ray.phi);
+        ray.z = ray.r * cos(ray.theta);
+        lambda = saved.lambda;
+        dL = saved.v.w;
+        i = saved.steps;
+    }
+
+    vec3 endPos;
+    int hit = integrate(ray, lambda, dL, i, min(i + waveSteps, MAX_STEPS), endPos);
+    if (hit >= 0) {
+        writePixel(pix, hit, endPos);
+        return;
+    }
+
+    WaveRay saved;
+    saved.q = vec4(ray.r, ray.theta, ray.phi, ray.E);
+    saved.v = vec4(ray.dr, ray.dtheta, ray.dphi, dL);
+    saved.lambda = lambda;
+    saved.steps = i;
+    saved.pix = uint(pix.x) | uint(pix.y) << 16;
+    waveRays[slot] = saved;
+
+    uint outList = 1u - waveParity;
+    uint position = atomicAdd(waveHeader[outList].w, 1u);
+    waveList[outList * waveListStride + position] = slot;
+    if (position % uint(LOCAL_SIZE * LOCAL_SIZE) == 0u) atomicAdd(waveHeader[outList].x, 1u);
+}
+#endif
+
+void main() {
+#if WAVEFRONT
+    advanceWave();
+#else
+    if (refineTiles) {
+        uint tile = tiles[gl_WorkGroupID.x];
+        ivec2 origin = ivec2(tile & 0xFFFFu, tile >> 16) * 16 + ivec2(gl_LocalInvocationID.xy);
+        for (int y = 0; y < 16; y += LOCAL_SIZE)
+            for (int x = 0; x < 16; x += LOCAL_SIZE)
+                trace(origin + ivec2(x, y));
+        return;
+    }
+    trace((tileOrigin + ivec2(gl_GlobalInvocationID.xy)) * sampleStride + sampleOffset);
+#endif
 }
 )";
 
@@ -1,13 +1,30 @@
 #ifndef BLACKHOLESFML_GRID_SHADER_H
 #define BLACKHOLESFML_GRID_SHADER_H
 
+// The grid mesh is flat and static; the well under every mass is added here.
+// With more masses than the uniform array holds, Engine computes the heights on
+// the CPU and feeds them through aHeight instead.
 inline auto gridVert = R"(
 #version 330 core
-layout(location = 0) in vec3 aPos;
+layout(location = 0) in vec2 aPos;    // x, z
+layout(location = 1) in float aHeight;
 uniform mat4 viewProj;
+uniform bool cpuHeights;
+uniform int numMasses;
+uniform vec4 masses[16];              // xyz position, w Schwarzschild radius
 
 void main() {
-    gl_Position = viewProj * vec4(aPos, 1.0);
+    float y = 0.0;
+    if (cpuHeights) {
+        y = aHeight;
+    } else {
+        for (int i = 0; i < numMasses; ++i) {
+            float rs = masses[i].w;
+            float dist = distance(aPos, masses[i].xz);
+            y += (dist > rs ? 2.0 * sqrt(rs * (dist - rs)) : 2.0 * rs) - 3e10;
+        }
+    }
+    gl_Position = viewProj * vec4(aPos.x, y, aPos.y, 1.0);
 }
 )";
 
@@ -0,0 +1,96 @@
+#ifndef BLACKHOLESFML_PROGRESSIVE_SHADER_H
+#define BLACKHOLESFML_PROGRESSIVE_SHADER_H
+
+// Progressive refinement passes around the tracing kernels. Each frame traces one
+// pixel out of every sampleStride x sampleStride block; these passes carry the
+// rest of the image over from the previous frame.
+
+// Moves the previous frame into the new camera view. Every pixel is pushed onto a
+// proxy plane through the orbit target and looked up in the previous camera, which
+// keeps the hole in place while orbiting and zooming. Pixels with no history are
+// marked 0 in sampleState so fillComp can patch them.
+inline auto reprojectComp = R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) writeonly uniform image2D outImage;
+layout(binding = 1, r8ui) writeonly uniform uimage2D sampleState;
+layout(binding = 0) uniform sampler2D history;
+
+layout(std140, binding = 1) uniform Camera {
+    vec3 camPos;     float _pad0;
+    vec3 camRight;   float _pad1;
+    vec3 camUp;      float _pad2;
+    vec3 camForward; float _pad3;
+    float tanHalfFov;
+    bool moving;
+    float aspect;
+    int   _pad4;
+} cam;
+
+uniform ivec2 texSize;
+uniform bool hasHistory;
+uniform float focusDistance; // camera to orbit target
+uniform vec3 prevPos;
+uniform vec3 prevRight;
+uniform vec3 prevUp;
+uniform vec3 prevForward;
+
+void main() {
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    if (pix.x >= texSize.x || pix.y >= texSize.y) return;
+
+    vec4 color = vec4(0.0);
+    uint state = 0u;
+    if (hasHistory) {
+        float u = (2.0 * (pix.x + 0.5) / texSize.x - 1.0) * cam.aspect * cam.tanHalfFov;
+        float v = (1.0 - 2.0 * (pix.y + 0.5) / texSize.y) * cam.tanHalfFov;
+        vec3 dir = u * cam.camRight - v * cam.camUp + cam.camForward;
+        vec3 rel = cam.camPos + dir * focusDistance - prevPos;
+
+        float z = dot(rel, prevForward);
+        if (z > 0.0) {
+            float pu = dot(rel, prevRight) / z / (cam.aspect * cam.tanHalfFov);
+            float pv = -dot(rel, prevUp) / z / cam.tanHalfFov;
+            ivec2 src = ivec2(floor(vec2((pu + 1.0) * 0.5 * texSize.x, (1.0 - pv) * 0.5 * texSize.y)));
+            if (all(greaterThanEqual(src, ivec2(0))) && all(lessThan(src, texSize))) {
+                color = texelFetch(history, src, 0);
+                state = 1u;
+            }
+        }
+    }
+
+    imageStore(outImage, pix, color);
+    imageStore(sampleState, pix, uvec4(state));
+}
+)";
+
+// Runs after a trace pass that followed a reprojection: pixels without history
+// copy the sample just traced in their block.
+inline auto fillComp = R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, rgba8) uniform image2D outImage;
+layout(binding = 1, r8ui) uniform uimage2D sampleState;
+
+uniform ivec2 texSize;
+uniform ivec2 sampleOffset;
+uniform int sampleStride;
+
+void main() {
+    ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+    if (pix.x >= texSize.x || pix.y >= texSize.y) return;
+    if (imageLoad(sampleState, pix).r != 0u) return;
+
+    // a partial block at the right or bottom edge may not contain this pass's sample,
+    // the previous block on that axis does; without one the pixel waits for its own phase
+    ivec2 traced = (pix / sampleStride) * sampleStride + sampleOffset;
+    traced -= ivec2(greaterThanEqual(traced, texSize)) * sampleStride;
+    if (any(lessThan(traced, ivec2(0)))) return;
+    imageStore(outImage, pix, imageLoad(outImage, traced));
+    imageStore(sampleState, pix, uvec4(1u));
+}
+)";
+
+#endif //BLACKHOLESFML_PROGRESSIVE_SHADER_H